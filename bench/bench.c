@@ -0,0 +1,641 @@
+/*
+ * Benchmarks of the Str operations against libc baselines. Prints one JSON object per line.
+ *
+ * Usage: str_bench [min_time_seconds] [benchmark_name_filter]
+ */
+
+#define _GNU_SOURCE
+
+#include "../str.h"
+#include "bench_common.h"
+
+#include <ctype.h>
+
+static void *bench_allocate(void *context, int64_t size)
+{
+    (void) context;
+    bench_allocations++;
+    return malloc(size);
+}
+
+static void *bench_reallocate(void *context, void *ptr, int64_t old_size, int64_t new_size)
+{
+    (void) context;
+    (void) old_size;
+    bench_allocations++;
+    return realloc(ptr, new_size);
+}
+
+static void bench_release(void *context, void *ptr, int64_t size)
+{
+    (void) context;
+    (void) size;
+    free(ptr);
+}
+
+/**
+ * Forwards to malloc() and counts the allocations of the Str benchmarks.
+ */
+static const StrAllocator bench_allocator = {bench_allocate, bench_reallocate, bench_release, NULL};
+
+/**
+ * A growable buffer used by the libc baselines, with the same doubling policy as Str.
+ */
+typedef struct BenchBuffer
+{
+    char *data;
+    int64_t length;
+    int64_t size;
+} BenchBuffer;
+
+static void bench_buffer_init(BenchBuffer *buffer)
+{
+    buffer->size = 16;
+    buffer->length = 0;
+    buffer->data = malloc(buffer->size);
+    buffer->data[0] = '\0';
+    bench_allocations++;
+}
+
+static void bench_buffer_reserve(BenchBuffer *buffer, int64_t min_size)
+{
+    if (min_size > buffer->size) {
+        buffer->size = BENCH_MAX(buffer->size * 2, min_size);
+        buffer->data = realloc(buffer->data, buffer->size);
+        bench_allocations++;
+    }
+}
+
+
+static void bench_buffer_append(BenchBuffer *buffer, const char *s, int64_t length)
+{
+    bench_buffer_reserve(buffer, buffer->length + length + 1);
+    memcpy(buffer->data + buffer->length, s, length);
+    buffer->length += length;
+    buffer->data[buffer->length] = '\0';
+}
+
+/* init/finalize */
+
+static void str_init_finalize(const BenchInput *input, int64_t iterations)
+{
+    for (int64_t i = 0; i < iterations; i++) {
+        Str str;
+        str_init_allocator(&str, input->size, &bench_allocator);
+        bench_escape(str.value);
+        str_finalize(&str);
+    }
+}
+
+static void libc_init_finalize(const BenchInput *input, int64_t iterations)
+{
+    for (int64_t i = 0; i < iterations; i++) {
+        char *p = malloc(input->size);
+        bench_allocations++;
+        bench_escape(p);
+        free(p);
+    }
+}
+
+/* Appends */
+
+static void str_append_char_bench(const BenchInput *input, int64_t iterations)
+{
+    for (int64_t i = 0; i < iterations; i++) {
+        Str str;
+        str_init_allocator(&str, STR_DEFAULT_INIT_SIZE, &bench_allocator);
+
+        for (int64_t j = 0; j < input->size; j++) {
+            str_append_char(&str, input->text[j]);
+        }
+
+        bench_escape(str.value);
+        str_finalize(&str);
+    }
+}
+
+static void libc_append_char(const BenchInput *input, int64_t iterations)
+{
+    for (int64_t i = 0; i < iterations; i++) {
+        BenchBuffer buffer;
+        bench_buffer_init(&buffer);
+
+        for (int64_t j = 0; j < input->size; j++) {
+            bench_buffer_reserve(&buffer, buffer.length + 2);
+            buffer.data[buffer.length++] = input->text[j];
+            buffer.data[buffer.length] = '\0';
+        }
+
+        bench_escape(buffer.data);
+        free(buffer.data);
+    }
+}
+
+static void str_append_str_bench(const BenchInput *input, int64_t iterations)
+{
+    for (int64_t i = 0; i < iterations; i++) {
+        Str str;
+        str_init_allocator(&str, STR_DEFAULT_INIT_SIZE, &bench_allocator);
+
+        for (int64_t j = 0; j < input->size; j += 16) {
+            str_append_str(&str, input->text + j, BENCH_MIN(16, input->size - j));
+        }
+
+        bench_escape(str.value);
+        str_finalize(&str);
+    }
+}
+
+
+static void libc_append_str(const BenchInput *input, int64_t iterations)
+{
+    for (int64_t i = 0; i < iterations; i++) {
+        BenchBuffer buffer;
+        bench_buffer_init(&buffer);
+
+        for (int64_t j = 0; j < input->size; j += 16) {
+            bench_buffer_append(&buffer, input->text + j, BENCH_MIN(16, input->size - j));
+        }
+
+        bench_escape(buffer.data);
+        free(buffer.data);
+    }
+}
+
+static void str_append_view_bench(const BenchInput *input, int64_t iterations)
+{
+    for (int64_t i = 0; i < iterations; i++) {
+        Str str;
+        str_init_allocator(&str, STR_DEFAULT_INIT_SIZE, &bench_allocator);
+
+        for (int64_t j = 0; j < input->size; j += 16) {
+            str_append_view(&str, str_view_str(input->text + j, BENCH_MIN(16, input->size - j)));
+        }
+
+        bench_escape(str.value);
+        str_finalize(&str);
+    }
+}
+
+static void str_concat_bench(const BenchInput *input, int64_t iterations)
+{
+    Str chunk;
+    str_init(&chunk);
+    str_append_str(&chunk, input->text, BENCH_MIN(16, input->size));
+
+    for (int64_t i = 0; i < iterations; i++) {
+        Str str;
+        str_init_allocator(&str, STR_DEFAULT_INIT_SIZE, &bench_allocator);
+
+        while (str.length < input->size) {
+            str_concat(&str, &chunk);
+        }
+
+        bench_escape(str.value);
+        str_finalize(&str);
+    }
+
+    str_finalize(&chunk);
+}
+
+/**
+ * Appends numbers until the string reaches the size of the input. The values cover every digit count.
+ */
+#define BENCH_APPEND_NUMBERS(append) \
+    for (int64_t i = 0; i < iterations; i++) { \
+        Str str; \
+        uint64_t n = 1; \
+        str_init_allocator(&str, STR_DEFAULT_INIT_SIZE, &bench_allocator); \
+        while (str.length < input->size) { \
+            n = n * 6364136223846793005ULL + 1442695040888963407ULL; \
+            append; \
+        } \
+        bench_escape(str.value); \
+        str_finalize(&str); \
+    }
+
+#define BENCH_SNPRINTF_NUMBERS(format, value) \
+    for (int64_t i = 0; i < iterations; i++) { \
+        BenchBuffer buffer; \
+        uint64_t n = 1; \
+        bench_buffer_init(&buffer); \
+        while (buffer.length < input->size) { \
+            n = n * 6364136223846793005ULL + 1442695040888963407ULL; \
+            bench_buffer_reserve(&buffer, buffer.length + 64); \
+            buffer.length += snprintf(buffer.data + buffer.length, 64, format, value); \
+        } \
+        bench_escape(buffer.data); \
+        free(buffer.data); \
+    }
+
+#define BENCH_INT_VALUE ((int64_t) n >> (n & 63))
+#define BENCH_UINT_VALUE (n >> (n & 63))
+#define BENCH_DOUBLE_VALUE ((double) (int64_t) (n >> 11) / (double) (1 + (n & 0xffff)))
+
+static void str_append_int_bench(const BenchInput *input, int64_t iterations)
+{
+    BENCH_APPEND_NUMBERS(str_append_int(&str, BENCH_INT_VALUE))
+}
+
+static void libc_append_int(const BenchInput *input, int64_t iterations)
+{
+    BENCH_SNPRINTF_NUMBERS("%lld", (long long) BENCH_INT_VALUE)
+}
+
+static void str_append_uint_bench(const BenchInput *input, int64_t iterations)
+{
+    BENCH_APPEND_NUMBERS(str_append_uint(&str, BENCH_UINT_VALUE))
+}
+
+static void libc_append_uint(const BenchInput *input, int64_t iterations)
+{
+    BENCH_SNPRINTF_NUMBERS("%llu", (unsigned long long) BENCH_UINT_VALUE)
+}
+
+static void str_append_int_format_bench(const BenchInput *input, int64_t iterations)
+{
+    BENCH_APPEND_NUMBERS(str_append_int_format(&str, BENCH_INT_VALUE, STR_INT_DECIMAL, 12, STR_PAD_SPACE))
+}
+
+static void libc_append_int_format(const BenchInput *input, int64_t iterations)
+{
+    BENCH_SNPRINTF_NUMBERS("%12lld", (long long) BENCH_INT_VALUE)
+}
+
+static void str_append_uint_format_bench(const BenchInput *input, int64_t iterations)
+{
+    BENCH_APPEND_NUMBERS(str_append_uint_format(&str, BENCH_UINT_VALUE, STR_INT_HEX, 16, STR_PAD_ZERO))
+}
+
+static void libc_append_uint_format(const BenchInput *input, int64_t iterations)
+{
+    BENCH_SNPRINTF_NUMBERS("%016llx", (unsigned long long) BENCH_UINT_VALUE)
+}
+
+static void str_append_float_bench(const BenchInput *input, int64_t iterations)
+{
+    BENCH_APPEND_NUMBERS(str_append_float(&str, BENCH_DOUBLE_VALUE, 6))
+}
+
+static void libc_append_float(const BenchInput *input, int64_t iterations)
+{
+    BENCH_SNPRINTF_NUMBERS("%.6f", BENCH_DOUBLE_VALUE)
+}
+
+static void str_append_float_shortest_bench(const BenchInput *input, int64_t iterations)
+{
+    BENCH_APPEND_NUMBERS(str_append_float_shortest(&str, BENCH_DOUBLE_VALUE))
+}
+
+static void libc_append_float_shortest(const BenchInput *input, int64_t iterations)
+{
+    /* libc has no shortest mode: %.17g is the closest round-trip format */
+    BENCH_SNPRINTF_NUMBERS("%.17g", BENCH_DOUBLE_VALUE)
+}
+
+static void str_append_format_bench(const BenchInput *input, int64_t iterations)
+{
+    BENCH_APPEND_NUMBERS(str_append_format(&str, "%s=%d;", "key", (int) n))
+}
+
+static void libc_append_format(const BenchInput *input, int64_t iterations)
+{
+    BENCH_SNPRINTF_NUMBERS("key=%d;", (int) n)
+}
+
+static void str_append_format_compiled_bench(const BenchInput *input, int64_t iterations)
+{
+    StrFormat format;
+    str_format_init(&format, "%s=%d;");
+    BENCH_APPEND_NUMBERS(str_append_format_compiled(&str, &format, "key", (int) n))
+    str_format_finalize(&format);
+}
+
+/* Search */
+
+static void str_indexof_realistic(const BenchInput *input, int64_t iterations)
+{
+    Str str;
+    str_init(&str);
+    str_append_str(&str, input->text, input->size);
+
+    for (int64_t i = 0; i < iterations; i++) {
+        int64_t index = str_indexof_str(&str, BENCH_SEARCH_NEEDLE, -1);
+        bench_escape(&index);
+    }
+
+    str_finalize(&str);
+}
+
+static void libc_indexof_realistic(const BenchInput *input, int64_t iterations)
+{
+    for (int64_t i = 0; i < iterations; i++) {
+        const void *r = memmem(input->text, input->size, BENCH_SEARCH_NEEDLE, strlen(BENCH_SEARCH_NEEDLE));
+        bench_escape(r);
+    }
+}
+
+static void str_indexof_adversarial_short(const BenchInput *input, int64_t iterations)
+{
+    Str str;
+    str_init(&str);
+    str_append_str(&str, input->adversarial, input->size);
+
+    for (int64_t i = 0; i < iterations; i++) {
+        int64_t index = str_indexof_str(&str, input->short_needle, 8);
+        bench_escape(&index);
+    }
+
+    str_finalize(&str);
+}
+
+static void libc_indexof_adversarial_short(const BenchInput *input, int64_t iterations)
+{
+    for (int64_t i = 0; i < iterations; i++) {
+        const void *r = memmem(input->adversarial, input->size, input->short_needle, 8);
+        bench_escape(r);
+    }
+}
+
+static void str_indexof_adversarial_long(const BenchInput *input, int64_t iterations)
+{
+    Str str;
+    str_init(&str);
+    str_append_str(&str, input->adversarial, input->size);
+
+    for (int64_t i = 0; i < iterations; i++) {
+        int64_t index = str_indexof_str(&str, input->long_needle, 64);
+        bench_escape(&index);
+    }
+
+    str_finalize(&str);
+}
+
+static void libc_indexof_adversarial_long(const BenchInput *input, int64_t iterations)
+{
+    for (int64_t i = 0; i < iterations; i++) {
+        const void *r = memmem(input->adversarial, input->size, input->long_needle, 64);
+        bench_escape(r);
+    }
+}
+
+/* Trim */
+
+static void str_trim_bench(const BenchInput *input, int64_t iterations)
+{
+    const int64_t length = input->size + BENCH_PADDING * 2;
+    Str str;
+    str_init_allocator(&str, length + 1, &bench_allocator);
+
+    for (int64_t i = 0; i < iterations; i++) {
+        str_set_length(&str, 0);
+        str_append_str(&str, input->padded, length);
+        str_trim(&str, STR_TRIM_BOTH);
+        bench_escape(str.value);
+    }
+
+    str_finalize(&str);
+}
+
+static void libc_trim(const BenchInput *input, int64_t iterations)
+{
+    const int64_t length = input->size + BENCH_PADDING * 2;
+    char *buffer = malloc(length + 1);
+
+    for (int64_t i = 0; i < iterations; i++) {
+        memcpy(buffer, input->padded, length + 1);
+
+        char *s = buffer;
+        char *e = buffer + length;
+
+        while (s < e && isspace((unsigned char) *s)) {
+            s++;
+        }
+
+        while (e > s && isspace((unsigned char) e[-1])) {
+            e--;
+        }
+
+        memmove(buffer, s, e - s);
+        buffer[e - s] = '\0';
+        bench_escape(buffer);
+    }
+
+    free(buffer);
+}
+
+static void str_view_trim_bench(const BenchInput *input, int64_t iterations)
+{
+    const StrView padded = str_view_str(input->padded, input->size + BENCH_PADDING * 2);
+
+    for (int64_t i = 0; i < iterations; i++) {
+        StrView trimmed = str_view_trim(padded, STR_TRIM_BOTH);
+        bench_escape(&trimmed);
+    }
+}
+
+/* Case conversion */
+
+static void str_to_lower_bench(const BenchInput *input, int64_t iterations)
+{
+    Str str;
+    str_init(&str);
+    str_append_str(&str, input->text, input->size);
+
+    for (int64_t i = 0; i < iterations; i++) {
+        if (i & 1) {
+            str_to_upper(&str);
+        } else {
+            str_to_lower(&str);
+        }
+
+        bench_escape(str.value);
+    }
+
+    str_finalize(&str);
+}
+
+static void libc_to_lower(const BenchInput *input, int64_t iterations)
+{
+    char *buffer = malloc(input->size + 1);
+    memcpy(buffer, input->text, input->size + 1);
+
+    for (int64_t i = 0; i < iterations; i++) {
+        int (*convert)(int) = (i & 1) ? toupper : tolower;
+
+        for (int64_t j = 0; j < input->size; j++) {
+            buffer[j] = (char) convert((unsigned char) buffer[j]);
+        }
+
+        bench_escape(buffer);
+    }
+
+    free(buffer);
+}
+
+/* Repeat */
+
+static void str_repeat_bench(const BenchInput *input, int64_t iterations)
+{
+    const int64_t unit = BENCH_MIN(16, input->size);
+
+    for (int64_t i = 0; i < iterations; i++) {
+        Str str;
+        str_init_allocator(&str, STR_DEFAULT_INIT_SIZE, &bench_allocator);
+        str_append_str(&str, input->text, unit);
+        str_repeat(&str, (int) (input->size / unit));
+        bench_escape(str.value);
+        str_finalize(&str);
+    }
+}
+
+static void libc_repeat(const BenchInput *input, int64_t iterations)
+{
+    const int64_t unit = BENCH_MIN(16, input->size);
+    const int64_t count = input->size / unit;
+
+    for (int64_t i = 0; i < iterations; i++) {
+        char *buffer = malloc(unit * count + 1);
+        bench_allocations++;
+
+        for (int64_t j = 0; j < count; j++) {
+            memcpy(buffer + j * unit, input->text, unit);
+        }
+
+        buffer[unit * count] = '\0';
+        bench_escape(buffer);
+        free(buffer);
+    }
+}
+
+/* Comparison */
+
+static void str_compare_bench(const BenchInput *input, int64_t iterations)
+{
+    Str a;
+    Str b;
+    str_init(&a);
+    str_init(&b);
+    str_append_str(&a, input->text, input->size);
+    str_append_str(&b, input->text, input->size);
+
+    for (int64_t i = 0; i < iterations; i++) {
+        int result = str_compare(&a, &b);
+        bench_escape(&result);
+    }
+
+    str_finalize(&a);
+    str_finalize(&b);
+}
+
+static void libc_compare(const BenchInput *input, int64_t iterations)
+{
+    char *copy = malloc(input->size + 1);
+    memcpy(copy, input->text, input->size + 1);
+
+    for (int64_t i = 0; i < iterations; i++) {
+        int result = memcmp(input->text, copy, input->size);
+        bench_escape(&result);
+    }
+
+    free(copy);
+}
+
+static void str_compare_ci_bench(const BenchInput *input, int64_t iterations)
+{
+    Str a;
+    Str b;
+    str_init(&a);
+    str_init(&b);
+    str_append_str(&a, input->text, input->size);
+    str_append_str(&b, input->text, input->size);
+    str_to_upper(&b);
+
+    for (int64_t i = 0; i < iterations; i++) {
+        int result = str_compare_ci(&a, &b);
+        bench_escape(&result);
+    }
+
+    str_finalize(&a);
+    str_finalize(&b);
+}
+
+static void libc_compare_ci(const BenchInput *input, int64_t iterations)
+{
+    char *copy = malloc(input->size + 1);
+    memcpy(copy, input->text, input->size + 1);
+
+    for (int64_t j = 0; j < input->size; j++) {
+        copy[j] = (char) toupper((unsigned char) copy[j]);
+    }
+
+    for (int64_t i = 0; i < iterations; i++) {
+        int result = strncasecmp(input->text, copy, input->size);
+        bench_escape(&result);
+    }
+
+    free(copy);
+}
+
+typedef struct BenchCase
+{
+    const char *name;
+    BenchFunc str;
+    BenchFunc libc;
+} BenchCase;
+
+static const BenchCase bench_cases[] = {
+    {"init_finalize", str_init_finalize, libc_init_finalize},
+    {"append_char", str_append_char_bench, libc_append_char},
+    {"append_str", str_append_str_bench, libc_append_str},
+    {"append_view", str_append_view_bench, NULL},
+    {"concat", str_concat_bench, NULL},
+    {"append_int", str_append_int_bench, libc_append_int},
+    {"append_uint", str_append_uint_bench, libc_append_uint},
+    {"append_int_format", str_append_int_format_bench, libc_append_int_format},
+    {"append_uint_format", str_append_uint_format_bench, libc_append_uint_format},
+    {"append_float", str_append_float_bench, libc_append_float},
+    {"append_float_shortest", str_append_float_shortest_bench, libc_append_float_shortest},
+    {"append_format", str_append_format_bench, libc_append_format},
+    {"append_format_compiled", str_append_format_compiled_bench, libc_append_format},
+    {"indexof_realistic", str_indexof_realistic, libc_indexof_realistic},
+    {"indexof_adversarial_short", str_indexof_adversarial_short, libc_indexof_adversarial_short},
+    {"indexof_adversarial_long", str_indexof_adversarial_long, libc_indexof_adversarial_long},
+    {"trim", str_trim_bench, libc_trim},
+    {"view_trim", str_view_trim_bench, NULL},
+    {"to_lower", str_to_lower_bench, libc_to_lower},
+    {"repeat", str_repeat_bench, libc_repeat},
+    {"compare", str_compare_bench, libc_compare},
+    {"compare_ci", str_compare_ci_bench, libc_compare_ci},
+};
+
+int main(int argc, char **argv)
+{
+    double min_time;
+    const char *filter;
+
+    bench_parse_args(argc, argv, &min_time, &filter);
+
+    for (int s = 0; s < BENCH_SIZE_COUNT; s++) {
+        BenchInput input;
+        bench_input_init(&input, bench_sizes[s]);
+
+        for (size_t i = 0; i < sizeof(bench_cases) / sizeof(bench_cases[0]); i++) {
+            const BenchCase *c = &bench_cases[i];
+
+            if (!bench_selected(c->name, filter)) {
+                continue;
+            }
+
+            bench_run(c->name, "str", &input, c->str, min_time);
+
+            if (c->libc) {
+                bench_run(c->name, "libc", &input, c->libc, min_time);
+            }
+        }
+
+        bench_input_finalize(&input);
+    }
+
+    return 0;
+}
@@ -0,0 +1,188 @@
+#ifndef STR_BENCH_COMMON_H
+#define STR_BENCH_COMMON_H
+
+/*
+ * Shared pieces of the benchmark programs: input generation, timing, allocation counting and JSON output.
+ * This header is compiled both as C and as C++.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_DEFAULT_MIN_TIME 0.05
+#define BENCH_SEARCH_NEEDLE "quartz sphinx"
+#define BENCH_PADDING 16
+
+#define BENCH_MIN(a, b) (((a) < (b)) ? (a) : (b))
+#define BENCH_MAX(a, b) (((a) > (b)) ? (a) : (b))
+
+/**
+ * The size classes every benchmark runs with, in bytes.
+ */
+static const int64_t bench_sizes[] = {8, 64, 1024, 65536};
+
+#define BENCH_SIZE_COUNT ((int) (sizeof(bench_sizes) / sizeof(bench_sizes[0])))
+
+/**
+ * The inputs of one size class. All strings are NUL-terminated.
+ */
+typedef struct BenchInput
+{
+    int64_t size;
+    char *text;          /* Words separated by spaces, mixed case, with BENCH_SEARCH_NEEDLE at the end */
+    char *padded;        /* The text with BENCH_PADDING whitespace bytes at both ends */
+    char *adversarial;   /* Only 'a' bytes */
+    char short_needle[9];  /* "aaaaaaab" */
+    char long_needle[65];  /* 63 'a' and a 'b' */
+} BenchInput;
+
+typedef void (*BenchFunc)(const BenchInput *input, int64_t iterations);
+
+/**
+ * Allocations made by the code under measurement. Each program routes its allocations through counters.
+ */
+static int64_t bench_allocations = 0;
+
+/**
+ * Keeps the compiler from optimizing away a computed value.
+ */
+static inline void bench_escape(const void *p)
+{
+#if defined(__GNUC__)
+    __asm__ volatile("" : : "g"(p) : "memory");
+#else
+    static const void *volatile sink;
+    sink = p;
+#endif
+}
+
+static inline double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+static void bench_input_init(BenchInput *input, int64_t size)
+{
+    static const char *const words[] = {
+        "The", "quick", "brown", "fox", "jumps", "over", "the", "lazy", "dog", "Lorem", "ipsum", "dolor", "sit",
+        "amet", "HTTP", "Content-Type", "host", "example", "value", "string"
+    };
+    const int64_t needle_length = (int64_t) strlen(BENCH_SEARCH_NEEDLE);
+    uint32_t seed = 12345;
+    int64_t length = 0;
+
+    input->size = size;
+    input->text = (char *) malloc(size + 1);
+    input->padded = (char *) malloc(size + BENCH_PADDING * 2 + 1);
+    input->adversarial = (char *) malloc(size + 1);
+
+    /* Words until the needle fills the rest of the text */
+    while (length < size - needle_length - 1) {
+        seed = seed * 1103515245 + 12345;
+        const char *word = words[(seed >> 16) % (sizeof(words) / sizeof(words[0]))];
+        int64_t word_length = (int64_t) strlen(word);
+
+        if (word_length > size - needle_length - 1 - length) {
+            word_length = size - needle_length - 1 - length;
+        }
+
+        memcpy(input->text + length, word, word_length);
+        length += word_length;
+        input->text[length++] = ' ';
+    }
+
+    if (size > needle_length) {
+        memcpy(input->text + size - needle_length, BENCH_SEARCH_NEEDLE, needle_length);
+    } else {
+        memset(input->text, 'x', size);
+    }
+
+    input->text[size] = '\0';
+
+    for (int i = 0; i < BENCH_PADDING; i++) {
+        input->padded[i] = " \t\n "[i % 4];
+        input->padded[BENCH_PADDING + size + i] = " \r\n "[i % 4];
+    }
+
+    memcpy(input->padded + BENCH_PADDING, input->text, size);
+    input->padded[size + BENCH_PADDING * 2] = '\0';
+
+    memset(input->adversarial, 'a', size);
+    input->adversarial[size] = '\0';
+
+    memset(input->short_needle, 'a', 7);
+    input->short_needle[7] = 'b';
+    input->short_needle[8] = '\0';
+    memset(input->long_needle, 'a', 63);
+    input->long_needle[63] = 'b';
+    input->long_needle[64] = '\0';
+}
+
+static void bench_input_finalize(BenchInput *input)
+{
+    free(input->text);
+    free(input->padded);
+    free(input->adversarial);
+}
+
+/**
+ * Runs the function with a growing number of iterations until it takes at least min_time seconds and prints
+ * the result as a JSON object on its own line.
+ */
+static void bench_run(const char *name, const char *impl, const BenchInput *input, BenchFunc func, double min_time)
+{
+    int64_t iterations = 1;
+    double elapsed;
+    int64_t allocations;
+
+    func(input, 1); /* Warm up */
+
+    for (;;) {
+        bench_allocations = 0;
+        const double start = bench_now();
+        func(input, iterations);
+        elapsed = bench_now() - start;
+        allocations = bench_allocations;
+
+        if (elapsed >= min_time || iterations >= ((int64_t) 1 << 40)) {
+            break;
+        }
+
+        iterations *= elapsed > 0 && min_time / elapsed < 10 ? 2 : 10;
+    }
+
+    const double ns_per_op = elapsed * 1e9 / (double) iterations;
+
+    printf(
+        "{\"benchmark\":\"%s\",\"impl\":\"%s\",\"size\":%lld,\"iterations\":%lld,\"ns_per_op\":%.3f,"
+        "\"mb_per_s\":%.3f,\"allocs_per_op\":%.3f}\n",
+        name, impl, (long long) input->size, (long long) iterations, ns_per_op,
+        (double) input->size / 1e6 / (ns_per_op * 1e-9), (double) allocations / (double) iterations
+    );
+    fflush(stdout);
+}
+
+/**
+ * Parses the command line: [min_time_seconds] [benchmark_name_filter].
+ */
+static void bench_parse_args(int argc, char **argv, double *min_time, const char **filter)
+{
+    *min_time = argc > 1 ? atof(argv[1]) : BENCH_DEFAULT_MIN_TIME;
+    *filter = argc > 2 ? argv[2] : NULL;
+
+    if (*min_time <= 0) {
+        *min_time = BENCH_DEFAULT_MIN_TIME;
+    }
+}
+
+static int bench_selected(const char *name, const char *filter)
+{
+    return filter == NULL || strstr(name, filter) != NULL;
+}
+
+#endif
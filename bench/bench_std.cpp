@@ -0,0 +1,269 @@
+/*
+ * std::string baselines for the benchmarks of bench.c. Prints one JSON object per line.
+ *
+ * Usage: std_bench [min_time_seconds] [benchmark_name_filter]
+ */
+
+#include "bench_common.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <new>
+#include <string>
+#include <string_view>
+
+/* Counts every allocation made through operator new */
+
+void *operator new(std::size_t size)
+{
+    bench_allocations++;
+
+    if (void *p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+static void std_init_finalize(const BenchInput *input, int64_t iterations)
+{
+    for (int64_t i = 0; i < iterations; i++) {
+        std::string str;
+        str.reserve(input->size);
+        bench_escape(str.data());
+    }
+}
+
+static void std_append_char(const BenchInput *input, int64_t iterations)
+{
+    for (int64_t i = 0; i < iterations; i++) {
+        std::string str;
+
+        for (int64_t j = 0; j < input->size; j++) {
+            str.push_back(input->text[j]);
+        }
+
+        bench_escape(str.data());
+    }
+}
+
+static void std_append_str(const BenchInput *input, int64_t iterations)
+{
+    for (int64_t i = 0; i < iterations; i++) {
+        std::string str;
+
+        for (int64_t j = 0; j < input->size; j += 16) {
+            str.append(input->text + j, BENCH_MIN(16, input->size - j));
+        }
+
+        bench_escape(str.data());
+    }
+}
+
+#define BENCH_APPEND_NUMBERS(append) \
+    for (int64_t i = 0; i < iterations; i++) { \
+        std::string str; \
+        uint64_t n = 1; \
+        while ((int64_t) str.size() < input->size) { \
+            n = n * 6364136223846793005ULL + 1442695040888963407ULL; \
+            append; \
+        } \
+        bench_escape(str.data()); \
+    }
+
+#define BENCH_INT_VALUE ((int64_t) n >> (n & 63))
+#define BENCH_UINT_VALUE (n >> (n & 63))
+#define BENCH_DOUBLE_VALUE ((double) (int64_t) (n >> 11) / (double) (1 + (n & 0xffff)))
+
+static void std_append_int(const BenchInput *input, int64_t iterations)
+{
+    BENCH_APPEND_NUMBERS(str += std::to_string(BENCH_INT_VALUE))
+}
+
+static void std_append_uint(const BenchInput *input, int64_t iterations)
+{
+    BENCH_APPEND_NUMBERS(str += std::to_string(BENCH_UINT_VALUE))
+}
+
+static void std_append_uint_format(const BenchInput *input, int64_t iterations)
+{
+    BENCH_APPEND_NUMBERS({
+        char buffer[16];
+        const auto r = std::to_chars(buffer, buffer + sizeof(buffer), BENCH_UINT_VALUE, 16);
+        str.append(16 - (r.ptr - buffer), '0');
+        str.append(buffer, r.ptr);
+    })
+}
+
+static void std_append_float(const BenchInput *input, int64_t iterations)
+{
+    BENCH_APPEND_NUMBERS(str += std::to_string(BENCH_DOUBLE_VALUE))
+}
+
+static void std_append_float_shortest(const BenchInput *input, int64_t iterations)
+{
+    BENCH_APPEND_NUMBERS({
+        char buffer[32];
+        const auto r = std::to_chars(buffer, buffer + sizeof(buffer), BENCH_DOUBLE_VALUE);
+        str.append(buffer, r.ptr);
+    })
+}
+
+static void std_indexof_realistic(const BenchInput *input, int64_t iterations)
+{
+    const std::string str(input->text, input->size);
+
+    for (int64_t i = 0; i < iterations; i++) {
+        std::size_t index = str.find(BENCH_SEARCH_NEEDLE);
+        bench_escape(&index);
+    }
+}
+
+static void std_indexof_adversarial_short(const BenchInput *input, int64_t iterations)
+{
+    const std::string str(input->adversarial, input->size);
+
+    for (int64_t i = 0; i < iterations; i++) {
+        std::size_t index = str.find(input->short_needle, 0, 8);
+        bench_escape(&index);
+    }
+}
+
+static void std_indexof_adversarial_long(const BenchInput *input, int64_t iterations)
+{
+    const std::string str(input->adversarial, input->size);
+
+    for (int64_t i = 0; i < iterations; i++) {
+        std::size_t index = str.find(input->long_needle, 0, 64);
+        bench_escape(&index);
+    }
+}
+
+static void std_trim(const BenchInput *input, int64_t iterations)
+{
+    static const char whitespace[] = " \t\n\v\f\r";
+    std::string str;
+    str.reserve(input->size + BENCH_PADDING * 2);
+
+    for (int64_t i = 0; i < iterations; i++) {
+        str.assign(input->padded, input->size + BENCH_PADDING * 2);
+        str.erase(str.find_last_not_of(whitespace) + 1);
+        str.erase(0, str.find_first_not_of(whitespace));
+        bench_escape(str.data());
+    }
+}
+
+static void std_view_trim(const BenchInput *input, int64_t iterations)
+{
+    static const char whitespace[] = " \t\n\v\f\r";
+    const std::string_view padded(input->padded, input->size + BENCH_PADDING * 2);
+
+    for (int64_t i = 0; i < iterations; i++) {
+        std::string_view trimmed = padded;
+        trimmed.remove_prefix(std::min(trimmed.find_first_not_of(whitespace), trimmed.size()));
+        trimmed.remove_suffix(trimmed.size() - std::min(trimmed.find_last_not_of(whitespace) + 1, trimmed.size()));
+        bench_escape(&trimmed);
+    }
+}
+
+static void std_to_lower(const BenchInput *input, int64_t iterations)
+{
+    std::string str(input->text, input->size);
+
+    for (int64_t i = 0; i < iterations; i++) {
+        if (i & 1) {
+            std::transform(str.begin(), str.end(), str.begin(), [](unsigned char c) { return std::toupper(c); });
+        } else {
+            std::transform(str.begin(), str.end(), str.begin(), [](unsigned char c) { return std::tolower(c); });
+        }
+
+        bench_escape(str.data());
+    }
+}
+
+static void std_repeat(const BenchInput *input, int64_t iterations)
+{
+    const int64_t unit = BENCH_MIN(16, input->size);
+    const int64_t count = input->size / unit;
+
+    for (int64_t i = 0; i < iterations; i++) {
+        std::string str;
+        str.reserve(unit * count);
+
+        for (int64_t j = 0; j < count; j++) {
+            str.append(input->text, unit);
+        }
+
+        bench_escape(str.data());
+    }
+}
+
+static void std_compare(const BenchInput *input, int64_t iterations)
+{
+    const std::string a(input->text, input->size);
+    const std::string b(input->text, input->size);
+
+    for (int64_t i = 0; i < iterations; i++) {
+        int result = a.compare(b);
+        bench_escape(&result);
+    }
+}
+
+struct BenchCase
+{
+    const char *name;
+    BenchFunc func;
+};
+
+static const BenchCase bench_cases[] = {
+    {"init_finalize", std_init_finalize},
+    {"append_char", std_append_char},
+    {"append_str", std_append_str},
+    {"append_int", std_append_int},
+    {"append_uint", std_append_uint},
+    {"append_uint_format", std_append_uint_format},
+    {"append_float", std_append_float},
+    {"append_float_shortest", std_append_float_shortest},
+    {"indexof_realistic", std_indexof_realistic},
+    {"indexof_adversarial_short", std_indexof_adversarial_short},
+    {"indexof_adversarial_long", std_indexof_adversarial_long},
+    {"trim", std_trim},
+    {"view_trim", std_view_trim},
+    {"to_lower", std_to_lower},
+    {"repeat", std_repeat},
+    {"compare", std_compare},
+};
+
+int main(int argc, char **argv)
+{
+    double min_time;
+    const char *filter;
+
+    bench_parse_args(argc, argv, &min_time, &filter);
+
+    for (int s = 0; s < BENCH_SIZE_COUNT; s++) {
+        BenchInput input;
+        bench_input_init(&input, bench_sizes[s]);
+
+        for (const BenchCase &c : bench_cases) {
+            if (bench_selected(c.name, filter)) {
+                bench_run(c.name, "std::string", &input, c.func, min_time);
+            }
+        }
+
+        bench_input_finalize(&input);
+    }
+
+    return 0;
+}
@@ -1,15 +1,149 @@
+#ifndef STR_NO_POSIX
+#ifdef __linux__
+#define _GNU_SOURCE
+#else
+#define _POSIX_C_SOURCE 200809L
+#endif
+#endif
+
 #include "str.h"
 
-#include <ctype.h>
+#include <errno.h>
+#include <float.h>
+#include <limits.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
 
-#define UINT64_MAX_STRLEN 20
+#ifdef STR_HAVE_POSIX
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#if defined(STR_STATS) && !defined(STR_HAVE_POSIX)
+#error "STR_STATS needs POSIX threads"
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define STR_HAVE_X86_SIMD 1
+#endif
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#define STR_HAVE_MALLOC_USABLE_SIZE 1
+#endif
+
+#if defined(__linux__) && defined(MREMAP_MAYMOVE)
+#define STR_HAVE_MREMAP 1
+#endif
+
+#if defined(STR_HAVE_X86_SIMD) && defined(__SSE2__)
+#define STR_HAVE_SSE2 1
+#endif
+
+#define STR_SEARCHER_RAITA_MIN 16
+#define STR_SEARCHER_TWO_WAY_MIN 64
+#define STR_TEDDY_MAX_PATTERNS 8
+#define STR_TEDDY_MAX_BYTES 3
+#define STR_ALIGNMENT 16
+#define STR_POOL_MIN_BLOCK 16
+#define STR_POOL_MAX_BLOCK (STR_POOL_MIN_BLOCK << (STR_POOL_CLASSES - 1))
+#define STR_DECIMAL_MAX_DIGITS 800
+#define STR_DECIMAL_MAX_SHIFT 60
+#define STR_INTERN_SHARD_BITS 4
+#define STR_INTERN_SHARDS (1 << STR_INTERN_SHARD_BITS)
+#define STR_INTERN_INITIAL_CAPACITY 64
+#define STR_CACHE_LINE 64
+#define STR_IO_CHUNK_SIZE 65536
+#define STR_IO_PROBE_SIZE 256
+#define STR_IO_MAX_TRANSFER ((int64_t) 1 << 30)
+#define STR_WRITER_REF_MIN 512
+#define STR_ROPE_WRITE_SEGMENTS 64
+#define STR_PAGE_SIZE 4096
+#define STR_GROWTH_PAGE_THRESHOLD ((int64_t) 1 << 20)
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define STR_LITTLE_ENDIAN 1
+#endif
 
 #define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#define MAX(a, b) (((a) > (b)) ? (a) : (b))
 #define STR_TAIL_P(str) ((str)->value + (str)->length)
+#define STR_IS_INLINE(str) ((str)->value == (str)->inline_value)
+#define STR_ALIGN(size) (((size) + STR_ALIGNMENT - 1) & ~((int64_t) STR_ALIGNMENT - 1))
+
+enum StrStatsCounter
+{
+    STR_STAT_REALLOCATIONS,
+    STR_STAT_GROWTHS,
+    STR_STAT_APPENDED_BYTES,
+    STR_STAT_REPEATED_BYTES,
+    STR_STAT_TRIMMED_BYTES,
+    STR_STAT_SEARCHES,
+    STR_STAT_SEARCHED_BYTES,
+    STR_STAT_SIZES,
+    STR_STAT_COUNT = STR_STAT_SIZES + STR_STATS_SIZE_BUCKETS
+};
+
+#ifdef STR_STATS
+/**
+ * The counters of one thread. Only the owner thread writes them, so increments are a relaxed load and store rather
+ * than a locked read-modify-write; the atomics only make the reads of str_stats_snapshot() well defined.
+ */
+struct StrStatsSlot
+{
+    struct StrStatsSlot *next;
+    struct StrStatsSlot *previous;
+    _Atomic int64_t counters[STR_STAT_COUNT];
+};
+
+static _Thread_local struct StrStatsSlot *str_stats_slot = NULL;
+static struct StrStatsSlot *str_stats_register(void);
+
+static inline void str_stats_add(enum StrStatsCounter counter, int64_t n)
+{
+    struct StrStatsSlot *slot = str_stats_slot ? str_stats_slot : str_stats_register();
+
+    if (slot) {
+        _Atomic int64_t *value = &slot->counters[counter];
+        atomic_store_explicit(value, atomic_load_explicit(value, memory_order_relaxed) + n, memory_order_relaxed);
+    }
+}
+
+/**
+ * Returns the histogram bucket of a buffer size: the index of its highest set bit.
+ */
+static inline int str_stats_bucket(int64_t size)
+{
+#ifdef __GNUC__
+    return 63 - __builtin_clzll((unsigned long long) size | 1);
+#else
+    int bucket = 0;
+
+    while (size > 1) {
+        size >>= 1;
+        bucket++;
+    }
+
+    return bucket;
+#endif
+}
+
+#define STR_STAT_ADD(counter, n) str_stats_add((counter), (n))
+#define STR_STAT_SIZE(size) str_stats_add(STR_STAT_SIZES + str_stats_bucket(size), 1)
+#else
+#define STR_STAT_ADD(counter, n) ((void) 0)
+#define STR_STAT_SIZE(size) ((void) 0)
+#endif
 
 /**
  * Calculates the length of the given string.
@@ -37,383 +171,5632 @@ static int str_memncmp(const char *a, int64_t a_len, const char *b, int64_t b_le
     return result;
 }
 
-static char *str_memnstr(char *s, int64_t s_len, const char *needle, int64_t needle_len)
+/**
+ * Portable substring search. Candidates are found with memchr() on the first byte of the needle and are
+ * filtered on the last byte before comparing the rest of the needle. Requires needle_len >= 2.
+ */
+static char *str_memnstr_scalar(char *s, int64_t s_len, const char *needle, int64_t needle_len)
 {
-    if (s_len == 0 || needle_len == 0) {
-        /* All strings contain an empty string */
-        return s;
-    }
-
-    if (s_len >= needle_len) {
-        if (needle_len == 1) {
-            return memchr(s, *needle, s_len);
-        } else {
-            const char *end = s + s_len;
-
-            /* Find the first starting character of needle in the haystack. */
-            s = memchr(s, *needle, end - s);
+    const char *last = s + s_len - needle_len;
+    const char tail = needle[needle_len - 1];
 
-            while (s != NULL && s + needle_len <= end) {
-                /* Compare and check if we have found the needle */
-                if (memcmp(s, needle, needle_len) == 0) {
-                    return s;
-                }
+    while (s <= last) {
+        s = memchr(s, *needle, last - s + 1);
+        if (s == NULL) {
+            break;
+        }
 
-                /* Not the needle. Check again */
-                s = memchr(s + needle_len, *needle, end - s + needle_len);
-            }
+        if (s[needle_len - 1] == tail && memcmp(s + 1, needle + 1, needle_len - 2) == 0) {
+            return s;
         }
+
+        s++;
     }
 
-    /* Needle was not found */
     return NULL;
 }
 
-bool str_init_size(Str *str, int64_t size)
+#ifdef STR_HAVE_X86_SIMD
+/**
+ * Vectorized substring search: compares 16 candidate positions at a time against the first and the last
+ * byte of the needle and only runs memcmp() on the positions where both bytes match.
+ */
+__attribute__((target("sse2")))
+static char *str_memnstr_sse2(char *s, int64_t s_len, const char *needle, int64_t needle_len)
 {
-    char *mem = malloc(sizeof(char) * size);
-    if (mem) {
-        str->value = mem;
-        str->size = size;
-        str->length = 0;
-        mem[0] = '\0';
-        return true;
-    }
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[needle_len - 1]);
+    const int64_t candidates = s_len - needle_len + 1;
+    int64_t i = 0;
 
-    return false;
-}
+    for (; i + 16 <= candidates; i += 16) {
+        const __m128i block_first = _mm_loadu_si128((const __m128i *) (s + i));
+        const __m128i block_last = _mm_loadu_si128((const __m128i *) (s + i + needle_len - 1));
+        unsigned mask = (unsigned) _mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(first, block_first), _mm_cmpeq_epi8(last, block_last))
+        );
 
-void str_finalize(Str *str)
-{
-    if (str && str->value) {
-        free(str->value);
-        str->value = NULL;
-        str->size = 0;
-        str->length = 0;
+        while (mask != 0) {
+            int64_t offset = i + __builtin_ctz(mask);
+            if (memcmp(s + offset + 1, needle + 1, needle_len - 2) == 0) {
+                return s + offset;
+            }
+
+            mask &= mask - 1;
+        }
     }
+
+    return str_memnstr_scalar(s + i, s_len - i, needle, needle_len);
 }
 
-bool str_set_size(Str *str, int64_t size)
+/**
+ * Same as str_memnstr_sse2() but checks 32 candidate positions at a time.
+ */
+__attribute__((target("avx2")))
+static char *str_memnstr_avx2(char *s, int64_t s_len, const char *needle, int64_t needle_len)
 {
-    char *mem = realloc(str->value, sizeof(char) * size);
-    if (mem) {
-        str->value = mem;
-        str->size = size;
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[needle_len - 1]);
+    const int64_t candidates = s_len - needle_len + 1;
+    int64_t i = 0;
 
-        if (str->length >= size) {
-            str->length = size - 1;
-            str->value[str->length] = '\0';
-        }
+    for (; i + 32 <= candidates; i += 32) {
+        const __m256i block_first = _mm256_loadu_si256((const __m256i *) (s + i));
+        const __m256i block_last = _mm256_loadu_si256((const __m256i *) (s + i + needle_len - 1));
+        unsigned mask = (unsigned) _mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(first, block_first), _mm256_cmpeq_epi8(last, block_last))
+        );
 
-        return true;
+        while (mask != 0) {
+            int64_t offset = i + __builtin_ctz(mask);
+            if (memcmp(s + offset + 1, needle + 1, needle_len - 2) == 0) {
+                return s + offset;
+            }
+
+            mask &= mask - 1;
+        }
     }
 
-    return false;
+    return str_memnstr_sse2(s + i, s_len - i, needle, needle_len);
 }
+#endif
 
-bool str_set_length(Str *str, int64_t length)
+typedef char *(*StrMemnstrFunc)(char *s, int64_t s_len, const char *needle, int64_t needle_len);
+
+static char *str_memnstr_resolve(char *s, int64_t s_len, const char *needle, int64_t needle_len);
+
+/**
+ * The search kernel used by str_memnstr(). It is selected on the first call based on the features of the CPU.
+ * Threads racing on the first call all store the same kernel, so relaxed atomics are enough.
+ */
+static _Atomic StrMemnstrFunc str_memnstr_impl = str_memnstr_resolve;
+
+static char *str_memnstr_resolve(char *s, int64_t s_len, const char *needle, int64_t needle_len)
 {
-    if (str_ensure_capacity(str, length + 1)) {
-        if (length > str->length) {
-            memset(STR_TAIL_P(str), 0, length - str->length);
-        }
+    StrMemnstrFunc impl = str_memnstr_scalar;
 
-        str->value[length] = '\0';
-        str->length = length;
-        return true;
+#ifdef STR_HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        impl = str_memnstr_avx2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        impl = str_memnstr_sse2;
     }
+#endif
 
-    return false;
+    atomic_store_explicit(&str_memnstr_impl, impl, memory_order_relaxed);
+    return impl(s, s_len, needle, needle_len);
 }
 
-bool str_ensure_capacity(Str *str, int64_t min_size)
+static char *str_memnstr(char *s, int64_t s_len, const char *needle, int64_t needle_len)
 {
-    if (min_size > str->size) {
-        int64_t size = str->size * 2;
-
-        if (min_size > size) {
-            size = min_size;
-        }
+    STR_STAT_ADD(STR_STAT_SEARCHES, 1);
+    STR_STAT_ADD(STR_STAT_SEARCHED_BYTES, s_len);
 
-        return str_set_size(str, size);
+    if (needle_len == 0) {
+        /* All strings contain an empty string */
+        return s;
     }
 
-    /* Allocated memory is large enough */
-    return true;
-}
+    if (s_len < needle_len) {
+        /* Needle is larger than the haystack */
+        return NULL;
+    }
 
-bool str_copy(const Str *source, Str *destination)
-{
-    if (str_init_size(destination, source->length + 1)) {
-        memcpy(destination->value, source->value, source->length);
-        destination->value[source->length] = '\0';
-        destination->length = source->length;
-        return true;
+    if (needle_len == 1) {
+        return memchr(s, *needle, s_len);
     }
 
-    return false;
+    const StrMemnstrFunc impl = atomic_load_explicit(&str_memnstr_impl, memory_order_relaxed);
+    return impl(s, s_len, needle, needle_len);
 }
 
-int str_compare(const Str *a, const Str *b)
-{
-    return str_memncmp(a->value, a->length, b->value, b->length);
-}
+/**
+ * The whitespace bytes of the C locale, as matched by isspace().
+ */
+static const StrCharSet str_whitespace = {
+    {((uint64_t) 1 << ' ') | ((uint64_t) 0x1f << '\t'), 0, 0, 0},
+    {' ', '\t', '\n', '\v', '\f', '\r'},
+    6
+};
 
-int str_compare_str(const Str *str, const char *s, int64_t length)
+#ifdef STR_HAVE_SSE2
+/**
+ * Returns a mask of the bytes of the block that belong to a set of up to 16 bytes.
+ */
+static inline unsigned str_charset_mask_sse2(const __m128i *chars, int count, __m128i block)
 {
-    if (length < 0) {
-        length = str_get_len(s);
+    __m128i found = _mm_cmpeq_epi8(block, chars[0]);
+
+    for (int i = 1; i < count; i++) {
+        found = _mm_or_si128(found, _mm_cmpeq_epi8(block, chars[i]));
     }
 
-    return str_memncmp(str->value, str->length, s, length);
+    return (unsigned) _mm_movemask_epi8(found);
 }
 
-bool str_equals_str(const Str *a, const char *s, int64_t length)
+/**
+ * Returns a mask of the whitespace bytes of the block. Needs no setup, unlike str_charset_mask_sse2().
+ */
+static inline unsigned str_whitespace_mask_sse2(__m128i block)
 {
-    if (length < 0) {
-        length = str_get_len(s);
-    }
+    /* '\t' to '\r' are contiguous: subtracting 9 and saturating at 4 leaves 0 only for them */
+    const __m128i control = _mm_subs_epu8(_mm_sub_epi8(block, _mm_set1_epi8('\t')), _mm_set1_epi8('\r' - '\t'));
+    const __m128i found = _mm_or_si128(
+        _mm_cmpeq_epi8(control, _mm_setzero_si128()),
+        _mm_cmpeq_epi8(block, _mm_set1_epi8(' '))
+    );
 
-    return a->length == length && memcmp(a->value, s, length) == 0;
+    return (unsigned) _mm_movemask_epi8(found);
 }
+#endif
 
-int64_t str_indexof_str(const Str *str, const char *substr, int64_t length)
+/**
+ * Returns the first byte of the range that belongs to the set, or NULL if there is none.
+ */
+static const char *str_charset_find(const StrCharSet *set, const char *s, const char *e)
 {
-    if (length < 0) {
-        length = str_get_len(substr);
+    if (set->count == 0) {
+        /* Nothing to find; the vector loop would match the zeroed chars[0] */
+        return NULL;
     }
 
-    const char *r = str_memnstr(str->value, str->length, substr, length);
-    if (r) {
-        return (int64_t) (r - str->value);
-    } else {
-        return -1;
+    if (set->count == 1) {
+        return memchr(s, set->chars[0], e - s);
     }
-}
 
-bool str_contains_str(const Str *str, const char *substr, int64_t length)
-{
-    if (length < 0) {
-        length = str_get_len(substr);
-    }
+#ifdef STR_HAVE_SSE2
+    if (set->count > 1 && set->count <= 16) {
+        __m128i chars[16];
 
-    const char *r = str_memnstr(str->value, str->length, substr, length);
-    return r != NULL;
-}
+        for (int i = 0; i < set->count; i++) {
+            chars[i] = _mm_set1_epi8(set->chars[i]);
+        }
 
-bool str_starts_with_str(const Str *str, const char *prefix, int64_t length)
-{
-    if (length < 0) {
-        length = str_get_len(prefix);
+        for (; e - s >= 16; s += 16) {
+            const unsigned mask = str_charset_mask_sse2(chars, set->count, _mm_loadu_si128((const __m128i *) s));
+            if (mask != 0) {
+                return s + __builtin_ctz(mask);
+            }
+        }
     }
+#endif
 
-    return str->length >= length && memcmp(str->value, prefix, length) == 0;
-}
-
-bool str_ends_with_str(const Str *str, const char *suffix, int64_t length)
-{
-    if (length < 0) {
-        length = str_get_len(suffix);
+    for (; s < e; s++) {
+        if (str_charset_contains(set, *s)) {
+            return s;
+        }
     }
 
-    return length >= 0 && memcmp(STR_TAIL_P(str) - length, suffix, length) == 0;
+    return NULL;
 }
 
-bool str_append_char(Str *str, char c)
+/**
+ * Returns the first byte of the range that does not belong to the set, or the end of the range.
+ */
+static const char *str_charset_span(const StrCharSet *set, const char *s, const char *e)
 {
-    if (str_ensure_capacity(str, str->length + 2)) {
-        str->value[str->length++] = c;
-        str->value[str->length] = '\0';
-        return true;
+    /* Most runs are short: check the first byte before setting up the vector loop */
+    if (s == e || !str_charset_contains(set, *s)) {
+        return s;
     }
 
-    return false;
-}
+#ifdef STR_HAVE_SSE2
+    if (set == &str_whitespace) {
+        for (; e - s >= 16; s += 16) {
+            const unsigned mask = str_whitespace_mask_sse2(_mm_loadu_si128((const __m128i *) s));
+            if (mask != 0xffff) {
+                return s + __builtin_ctz(~mask);
+            }
+        }
+    } else if (set->count <= 16) {
+        __m128i chars[16];
 
-bool str_append_str(Str *str, const char *s, int64_t len)
-{
-    if (len < 0) {
-        len = str_get_len(s);
+        for (int i = 0; i < set->count; i++) {
+            chars[i] = _mm_set1_epi8(set->chars[i]);
+        }
+
+        for (; e - s >= 16; s += 16) {
+            const unsigned mask = str_charset_mask_sse2(chars, set->count, _mm_loadu_si128((const __m128i *) s));
+            if (mask != 0xffff) {
+                return s + __builtin_ctz(~mask);
+            }
+        }
     }
+#endif
 
-    int64_t new_length = str->length + len;
-    if (str_ensure_capacity(str, new_length + 1)) {
-        memcpy(STR_TAIL_P(str), s, len);
-        str->value[new_length] = '\0';
-        str->length = new_length;
-        return true;
+    while (s < e && str_charset_contains(set, *s)) {
+        s++;
     }
 
-    return false;
+    return s;
 }
 
-bool str_append_format(Str *str, const char *format, ...)
+/**
+ * Returns the start of the run of bytes of the set that ends the range, or the end of the range if the last byte
+ * does not belong to the set.
+ */
+static const char *str_charset_span_reverse(const StrCharSet *set, const char *s, const char *e)
 {
-    va_list args;
-    va_start(args, format);
-
-    int length = vsnprintf(NULL, 0, format, args);
-    int64_t new_length = str->length + length;
+    if (s == e || !str_charset_contains(set, e[-1])) {
+        return e;
+    }
 
-    bool result = false;
+#ifdef STR_HAVE_SSE2
+    if (set == &str_whitespace) {
+        for (; e - s >= 16; e -= 16) {
+            const unsigned mask = str_whitespace_mask_sse2(_mm_loadu_si128((const __m128i *) (e - 16)));
+            if (mask != 0xffff) {
+                return e - 16 + (31 - __builtin_clz(~mask & 0xffff)) + 1;
+            }
+        }
+    } else if (set->count <= 16) {
+        __m128i chars[16];
 
-    if (str_ensure_capacity(str, new_length + 1)) {
-        int written = vsnprintf(STR_TAIL_P(str), str->size - str->length, format, args);
+        for (int i = 0; i < set->count; i++) {
+            chars[i] = _mm_set1_epi8(set->chars[i]);
+        }
 
-        if (written == length) {
-            result = true;
-            str->value[new_length] = '\0';
-            str->length = new_length;
-            result = true;
-        } else {
-            /* Restore \0 if vsnprintf() removed it */
-            str->value[str->length] = '\0';
+        for (; e - s >= 16; e -= 16) {
+            const unsigned mask = str_charset_mask_sse2(chars, set->count, _mm_loadu_si128((const __m128i *) (e - 16)));
+            if (mask != 0xffff) {
+                /* The highest byte outside of the set */
+                return e - 16 + (31 - __builtin_clz(~mask & 0xffff)) + 1;
+            }
         }
     }
+#endif
 
-    va_end(args);
-    return result;
-}
-
-static char *uint_to_string(char *buffer, uint64_t n, uint64_t base)
-{
-    *buffer = '\0';
-    do {
-        *--buffer = (char) ((n % base) + '0');
-        n /= base;
-    } while (n > 0);
+    while (e > s && str_charset_contains(set, e[-1])) {
+        e--;
+    }
 
-    return buffer;
+    return e;
 }
 
-static char *int_to_string(char *buffer, int64_t n, uint64_t base)
+/**
+ * Converts an ASCII letter to lowercase. Other bytes are returned unchanged.
+ */
+static inline unsigned char str_ascii_lower(unsigned char c)
 {
-    if (n < 0) {
-        char *result = uint_to_string(buffer, ~((uint64_t) n) + 1, base);
-        *--result = '-';
-        return result;
-    } else {
-        return uint_to_string(buffer, n, base);
-    }
+    return (c >= 'A' && c <= 'Z') ? (unsigned char) (c | 0x20) : c;
 }
 
-bool str_append_int(Str *str, int64_t value)
+#ifdef STR_HAVE_SSE2
+/**
+ * Returns a mask of the bytes of the block that are in the range [first, first + 25].
+ */
+static inline __m128i str_letter_mask_sse2(__m128i block, char first)
 {
-    if ((uint64_t) value <= 9) {
-        return str_append_char(str, (char) (value + '0'));
-    } else {
-        char buffer[UINT64_MAX_STRLEN + 1];
-        char *result = int_to_string(buffer + sizeof(buffer) - 1, value, 10);
-        return str_append_str(str, result, (int64_t) (buffer + sizeof(buffer) - 1 - result));
-    }
+    /* Moves the range to the bottom of the signed range so a single comparison is enough */
+    const __m128i shifted = _mm_add_epi8(block, _mm_set1_epi8((char) (0x80 - first)));
+    return _mm_cmplt_epi8(shifted, _mm_set1_epi8((char) (-128 + 26)));
 }
 
-bool str_append_uint(Str *str, uint64_t value)
+/**
+ * Converts the ASCII letters of the block to lowercase.
+ */
+static inline __m128i str_fold_sse2(__m128i block)
 {
-    if (value <= 9) {
-        return str_append_char(str, (char) (value + '0'));
-    } else {
-        char buffer[UINT64_MAX_STRLEN + 1];
-        char *result = uint_to_string(buffer + sizeof(buffer) - 1, value, 10);
-        return str_append_str(str, result, (int64_t) (buffer + sizeof(buffer) - 1 - result));
-    }
+    return _mm_or_si128(block, _mm_and_si128(str_letter_mask_sse2(block, 'A'), _mm_set1_epi8(0x20)));
 }
+#endif
 
-bool str_append_float(Str *str, double value, int precision)
+/**
+ * Returns the high bit of each byte of the word that is in the range [first, first + 25] (SWAR).
+ */
+static inline uint64_t str_letter_mask_swar(uint64_t v, unsigned char first)
 {
-    return str_append_format(str, "%.*f", precision, value);
+    const uint64_t ones = 0x0101010101010101;
+    const uint64_t high = 0x8080808080808080;
+    const uint64_t low = v & ~high;
+    const uint64_t at_least_first = low + ones * (0x80 - first);
+    const uint64_t above_last = low + ones * (0x7f - (first + 25));
+
+    return (at_least_first ^ above_last) & ~v & high;
 }
 
-static void str_case_convert(const Str *str, int (*convert)(int))
+/**
+ * Flips the case of the bytes in the range [first, first + 25]: 'A' converts to lowercase and 'a' to uppercase.
+ */
+static void str_ascii_case_convert(char *s, int64_t length, char first)
 {
-    char *s = str->value;
-    const char *e = STR_TAIL_P(str);
+    int64_t i = 0;
 
-    while (s < e) {
-        *s = (char) convert(*s);
-        s++;
+#ifdef STR_HAVE_SSE2
+    const __m128i flip = _mm_set1_epi8(0x20);
+
+    for (; i + 16 <= length; i += 16) {
+        const __m128i block = _mm_loadu_si128((const __m128i *) (s + i));
+        const __m128i letters = str_letter_mask_sse2(block, first);
+        _mm_storeu_si128((__m128i *) (s + i), _mm_xor_si128(block, _mm_and_si128(letters, flip)));
     }
-}
+#endif
 
-void str_to_lower(const Str *str)
-{
-    str_case_convert(str, tolower);
-}
+    /* 8 bytes at a time for the tail or without SSE2 */
+    for (; i + 8 <= length; i += 8) {
+        uint64_t word;
+        memcpy(&word, s + i, sizeof(word));
+        word ^= str_letter_mask_swar(word, (unsigned char) first) >> 2;
+        memcpy(s + i, &word, sizeof(word));
+    }
 
-void str_to_upper(const Str *str)
-{
-    str_case_convert(str, toupper);
+    for (; i < length; i++) {
+        const unsigned char c = (unsigned char) s[i];
+        if (c >= (unsigned char) first && c <= (unsigned char) first + 25) {
+            s[i] = (char) (c ^ 0x20);
+        }
+    }
 }
 
-void str_trim(Str *str, StrTrimOptions options)
+/**
+ * Returns the index of the first byte that differs between both strings ignoring the case of ASCII letters, or
+ * length if they are equal.
+ */
+static int64_t str_case_mismatch(const char *a, const char *b, int64_t length)
 {
-    const char *s = str->value;
-    const char *e = STR_TAIL_P(str);
+    int64_t i = 0;
 
-    if (options & STR_TRIM_LEFT) {
-        for (; s < e; s++) {
-            if (!isspace(*s)) {
-                break;
-            }
+#ifdef STR_HAVE_SSE2
+    for (; i + 16 <= length; i += 16) {
+        const __m128i block_a = str_fold_sse2(_mm_loadu_si128((const __m128i *) (a + i)));
+        const __m128i block_b = str_fold_sse2(_mm_loadu_si128((const __m128i *) (b + i)));
+        const unsigned mask = (unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(block_a, block_b));
+
+        if (mask != 0xffff) {
+            return i + __builtin_ctz(~mask);
         }
+    }
+#endif
 
-        if (s == e) {
-            /* Trim to empty string */
-            str->value[0] = '\0';
-            str->length = 0;
-            return;
+    for (; i + 8 <= length; i += 8) {
+        uint64_t word_a;
+        uint64_t word_b;
+        memcpy(&word_a, a + i, sizeof(word_a));
+        memcpy(&word_b, b + i, sizeof(word_b));
+        word_a |= str_letter_mask_swar(word_a, 'A') >> 2;
+        word_b |= str_letter_mask_swar(word_b, 'A') >> 2;
+
+        if (word_a != word_b) {
+            /* The scalar loop finds the byte */
+            break;
         }
+    }
 
-        str->length -= s - str->value;
-        if (s > str->value) {
-            memmove(str->value, s, str->length);
+    for (; i < length; i++) {
+        if (str_ascii_lower((unsigned char) a[i]) != str_ascii_lower((unsigned char) b[i])) {
+            return i;
         }
     }
 
-    if (options & STR_TRIM_RIGHT) {
-        for (e = e - 1; e >= s; e--) {
-            if (!isspace(*e)) {
-                break;
+    return length;
+}
+
+/**
+ * Compares 2 strings ignoring the case of ASCII letters.
+ */
+static int str_memncasecmp(const char *a, int64_t a_len, const char *b, int64_t b_len)
+{
+    const int64_t length = MIN(a_len, b_len);
+    const int64_t i = str_case_mismatch(a, b, length);
+
+    if (i < length) {
+        return str_ascii_lower((unsigned char) a[i]) < str_ascii_lower((unsigned char) b[i]) ? -1 : 1;
+    }
+
+    return (a_len > b_len) - (a_len < b_len);
+}
+
+/**
+ * Case-insensitive substring search for ASCII letters. Candidates are filtered on the folded first and last byte
+ * of the needle, 16 positions at a time when SSE2 is available. Requires needle_len >= 1.
+ */
+static const char *str_memncasestr(const char *s, int64_t s_len, const char *needle, int64_t needle_len)
+{
+    const unsigned char first = str_ascii_lower((unsigned char) needle[0]);
+    const unsigned char last = str_ascii_lower((unsigned char) needle[needle_len - 1]);
+    const int64_t candidates = s_len - needle_len + 1;
+    int64_t i = 0;
+
+#ifdef STR_HAVE_SSE2
+    const __m128i first_block = _mm_set1_epi8((char) first);
+    const __m128i last_block = _mm_set1_epi8((char) last);
+
+    for (; i + 16 <= candidates; i += 16) {
+        const __m128i block_first = str_fold_sse2(_mm_loadu_si128((const __m128i *) (s + i)));
+        const __m128i block_last = str_fold_sse2(_mm_loadu_si128((const __m128i *) (s + i + needle_len - 1)));
+        unsigned mask = (unsigned) _mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(first_block, block_first), _mm_cmpeq_epi8(last_block, block_last))
+        );
+
+        while (mask != 0) {
+            const int64_t offset = i + __builtin_ctz(mask);
+            if (needle_len <= 2 || str_case_mismatch(s + offset + 1, needle + 1, needle_len - 2) == needle_len - 2) {
+                return s + offset;
             }
+
+            mask &= mask - 1;
         }
+    }
+#endif
 
-        str->length = e - s + 1;
+    for (; i < candidates; i++) {
+        if (str_ascii_lower((unsigned char) s[i]) == first
+            && str_ascii_lower((unsigned char) s[i + needle_len - 1]) == last
+            && (needle_len <= 2 || str_case_mismatch(s + i + 1, needle + 1, needle_len - 2) == needle_len - 2)) {
+            return s + i;
+        }
     }
 
-    str->value[str->length] = '\0';
+    return NULL;
 }
 
-bool str_repeat(Str *str, int multiply)
+/**
+ * Allocates memory through the allocator, or malloc() if there is none.
+ */
+static void *str_mem_alloc(const StrAllocator *allocator, int64_t size)
 {
-    if (multiply < 0) {
-        return false;
+    if (allocator) {
+        return allocator->allocate(allocator->context, size);
     }
 
-    if (multiply == 0 || str->length == 0) {
-        // Truncate to empty
+    return malloc(size);
+}
+
+static void *str_mem_realloc(const StrAllocator *allocator, void *ptr, int64_t old_size, int64_t new_size)
+{
+    if (allocator) {
+        return allocator->reallocate(allocator->context, ptr, old_size, new_size);
+    }
+
+    return realloc(ptr, new_size);
+}
+
+static void str_mem_free(const StrAllocator *allocator, void *ptr, int64_t size)
+{
+    if (allocator) {
+        allocator->release(allocator->context, ptr, size);
+    } else {
+        free(ptr);
+    }
+}
+
+struct StrSharedBuffer
+{
+    _Atomic int64_t references;
+};
+
+#define STR_SHARED_HEADER_SIZE STR_ALIGN((int64_t) sizeof(struct StrSharedBuffer))
+#define STR_SHARED_BUFFER(value) ((struct StrSharedBuffer *) ((char *) (value) - STR_SHARED_HEADER_SIZE))
+
+static void *str_shared_allocate(void *context, int64_t size)
+{
+    (void) context;
+
+    struct StrSharedBuffer *buffer = malloc(STR_SHARED_HEADER_SIZE + size);
+    if (buffer == NULL) {
+        return NULL;
+    }
+
+    atomic_init(&buffer->references, 1);
+    return (char *) buffer + STR_SHARED_HEADER_SIZE;
+}
+
+/**
+ * Only called on buffers with a single reference: str_set_size() detaches shared ones first.
+ */
+static void *str_shared_reallocate(void *context, void *ptr, int64_t old_size, int64_t new_size)
+{
+    (void) context;
+    (void) old_size;
+
+    struct StrSharedBuffer *buffer = realloc(STR_SHARED_BUFFER(ptr), STR_SHARED_HEADER_SIZE + new_size);
+    if (buffer == NULL) {
+        return NULL;
+    }
+
+    return (char *) buffer + STR_SHARED_HEADER_SIZE;
+}
+
+static void str_shared_release(void *context, void *ptr, int64_t size)
+{
+    (void) context;
+    (void) size;
+
+    struct StrSharedBuffer *buffer = STR_SHARED_BUFFER(ptr);
+
+    /* The last owner frees the buffer once the writes of every other owner are visible */
+    if (atomic_fetch_sub_explicit(&buffer->references, 1, memory_order_release) == 1) {
+        atomic_thread_fence(memory_order_acquire);
+        free(buffer);
+    }
+}
+
+const StrAllocator str_shared_allocator = {str_shared_allocate, str_shared_reallocate, str_shared_release, NULL};
+
+/**
+ * Returns true if the buffer of the Str object is shared with other Str objects.
+ */
+static inline bool str_is_shared(const Str *str)
+{
+    return str->allocator == &str_shared_allocator && !STR_IS_INLINE(str)
+        && atomic_load_explicit(&STR_SHARED_BUFFER(str->value)->references, memory_order_acquire) > 1;
+}
+
+bool str_detach(Str *str)
+{
+    return !str_is_shared(str) || str_set_size(str, str->size);
+}
+
+bool str_init_size(Str *str, int64_t size)
+{
+    return str_init_allocator(str, size, NULL);
+}
+
+bool str_init_allocator(Str *str, int64_t size, const StrAllocator *allocator)
+{
+    str->allocator = allocator;
+
+    if (size <= STR_INLINE_SIZE) {
+        str->value = str->inline_value;
+        str->size = STR_INLINE_SIZE;
+        str->length = 0;
+        str->hash = 0;
         str->value[0] = '\0';
+        return true;
+    }
+
+    char *mem = str_mem_alloc(allocator, sizeof(char) * size);
+    if (mem) {
+        STR_STAT_SIZE(size);
+        str->value = mem;
+        str->size = size;
         str->length = 0;
+        str->hash = 0;
+        mem[0] = '\0';
         return true;
     }
 
-    int64_t length = str->length * multiply;
-    if (str_ensure_capacity(str, length + 1)) {
-        if (str->length == 1) {
-            memset(str->value, str->value[0], length);
-        } else {
-            char *s = STR_TAIL_P(str);
-            const char *e = str->value + length;
+    return false;
+}
 
-            while (s < e) {
-                memmove(s, str->value, str->length);
-                s += str->length;
-            }
+void str_finalize(Str *str)
+{
+    if (str && str->value) {
+        if (!STR_IS_INLINE(str)) {
+            str_mem_free(str->allocator, str->value, str->size);
+        }
+
+        str->value = NULL;
+        str->size = 0;
+        str->length = 0;
+        str->hash = 0;
+    }
+}
+
+bool str_set_size(Str *str, int64_t size)
+{
+    char *mem;
+
+    if (str_is_shared(str)) {
+        /* Copy into a private buffer and drop the reference to the shared one */
+        mem = str_mem_alloc(str->allocator, sizeof(char) * size);
+        if (mem) {
+            memcpy(mem, str->value, MIN(str->length + 1, size));
+            str_mem_free(str->allocator, str->value, str->size);
+        }
+    } else if (!STR_IS_INLINE(str)) {
+        mem = str_mem_realloc(str->allocator, str->value, str->size, sizeof(char) * size);
+    } else if (size <= STR_INLINE_SIZE) {
+        /* Still fits in the inline buffer */
+        mem = str->value;
+    } else {
+        /* Move the string to the heap */
+        mem = str_mem_alloc(str->allocator, sizeof(char) * size);
+        if (mem) {
+            memcpy(mem, str->value, str->length + 1);
+        }
+    }
+
+    if (mem) {
+        if (mem != str->inline_value) {
+            STR_STAT_ADD(STR_STAT_REALLOCATIONS, 1);
+            STR_STAT_SIZE(size);
+        }
+
+        str->value = mem;
+        str->size = size;
+
+        if (str->length >= size) {
+            str->length = size - 1;
+            str->hash = 0;
+            str->value[str->length] = '\0';
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+bool str_set_length(Str *str, int64_t length)
+{
+    if (str_ensure_capacity(str, length + 1)) {
+        if (length > str->length) {
+            memset(STR_TAIL_P(str), 0, length - str->length);
         }
 
         str->value[length] = '\0';
         str->length = length;
+        str->hash = 0;
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * The policy of str_grown_size(). It is meant to be set once at startup, but every growing thread reads it, so it
+ * is atomic; relaxed accesses are enough since no other data is published with it.
+ */
+static _Atomic StrGrowthPolicy str_growth_policy = STR_GROWTH_DOUBLE;
+
+void str_set_growth_policy(StrGrowthPolicy policy)
+{
+    atomic_store_explicit(&str_growth_policy, policy, memory_order_relaxed);
+}
+
+/**
+ * Returns the size a buffer of the given size grows to under the current policy.
+ */
+static int64_t str_grown_size(int64_t size, int64_t min_size)
+{
+    int64_t grown;
+
+    switch (atomic_load_explicit(&str_growth_policy, memory_order_relaxed)) {
+    case STR_GROWTH_ONE_AND_HALF:
+        grown = size + size / 2;
+        break;
+    case STR_GROWTH_PAGE:
+        if (min_size >= STR_GROWTH_PAGE_THRESHOLD) {
+            grown = MAX(size + size / 2, min_size);
+            return (grown + STR_PAGE_SIZE - 1) & ~((int64_t) STR_PAGE_SIZE - 1);
+        }
+
+        grown = size * 2;
+        break;
+    default:
+        grown = size * 2;
+        break;
+    }
+
+    return MAX(grown, min_size);
+}
+
+bool str_ensure_capacity(Str *str, int64_t min_size)
+{
+    if (min_size > str->size) {
+        STR_STAT_ADD(STR_STAT_GROWTHS, 1);
+
+        if (!str_set_size(str, str_grown_size(str->size, min_size))) {
+            return false;
+        }
+
+#ifdef STR_HAVE_MALLOC_USABLE_SIZE
+        /* malloc() rounds requests up to its bin sizes: claim the bytes that are already paid for */
+        if (str->allocator == NULL && !STR_IS_INLINE(str)) {
+            str->size = MAX(str->size, (int64_t) malloc_usable_size(str->value));
+        }
+#endif
+
+        return true;
+    }
+
+    /* Allocated memory is large enough, but writing to it needs a private copy */
+    return str_detach(str);
+}
+
+bool str_shrink_to_fit(Str *str)
+{
+    if (STR_IS_INLINE(str) || str->size == str->length + 1) {
+        return true;
+    }
+
+    if (str->length < STR_INLINE_SIZE) {
+        /* Move the string back to the inline buffer */
+        memcpy(str->inline_value, str->value, str->length + 1);
+        str_mem_free(str->allocator, str->value, str->size);
+        str->value = str->inline_value;
+        str->size = STR_INLINE_SIZE;
+        return true;
+    }
+
+    return str_set_size(str, str->length + 1);
+}
+
+bool str_copy(const Str *source, Str *destination)
+{
+    if (source->allocator == &str_shared_allocator && !STR_IS_INLINE(source)) {
+        /* Share the buffer: the first write to either object makes a private copy */
+        atomic_fetch_add_explicit(&STR_SHARED_BUFFER(source->value)->references, 1, memory_order_relaxed);
+        destination->value = source->value;
+        destination->size = source->size;
+        destination->length = source->length;
+        destination->allocator = source->allocator;
+        destination->hash = source->hash;
+        return true;
+    }
+
+    if (str_init_allocator(destination, source->length + 1, source->allocator)) {
+        memcpy(destination->value, source->value, source->length);
+        destination->value[source->length] = '\0';
+        destination->length = source->length;
+        destination->hash = source->hash;
         return true;
     }
 
     return false;
 }
+
+int str_compare(const Str *a, const Str *b)
+{
+    return str_memncmp(a->value, a->length, b->value, b->length);
+}
+
+int str_compare_str(const Str *str, const char *s, int64_t length)
+{
+    if (length < 0) {
+        length = str_get_len(s);
+    }
+
+    return str_memncmp(str->value, str->length, s, length);
+}
+
+bool str_equals_str(const Str *a, const char *s, int64_t length)
+{
+    if (length < 0) {
+        length = str_get_len(s);
+    }
+
+    return a->length == length && memcmp(a->value, s, length) == 0;
+}
+
+int64_t str_indexof_str(const Str *str, const char *substr, int64_t length)
+{
+    if (length < 0) {
+        length = str_get_len(substr);
+    }
+
+    const char *r = str_memnstr(str->value, str->length, substr, length);
+    if (r) {
+        return (int64_t) (r - str->value);
+    } else {
+        return -1;
+    }
+}
+
+int str_compare_ci_str(const Str *str, const char *s, int64_t length)
+{
+    if (length < 0) {
+        length = str_get_len(s);
+    }
+
+    return str_memncasecmp(str->value, str->length, s, length);
+}
+
+bool str_equals_ci_str(const Str *str, const char *s, int64_t length)
+{
+    if (length < 0) {
+        length = str_get_len(s);
+    }
+
+    return str->length == length && str_case_mismatch(str->value, s, length) == length;
+}
+
+int64_t str_indexof_ci_str(const Str *str, const char *substr, int64_t length)
+{
+    if (length < 0) {
+        length = str_get_len(substr);
+    }
+
+    if (length == 0) {
+        return 0;
+    }
+
+    if (str->length < length) {
+        return -1;
+    }
+
+    const char *r = str_memncasestr(str->value, str->length, substr, length);
+    if (r) {
+        return (int64_t) (r - str->value);
+    } else {
+        return -1;
+    }
+}
+
+bool str_contains_str(const Str *str, const char *substr, int64_t length)
+{
+    if (length < 0) {
+        length = str_get_len(substr);
+    }
+
+    const char *r = str_memnstr(str->value, str->length, substr, length);
+    return r != NULL;
+}
+
+bool str_starts_with_str(const Str *str, const char *prefix, int64_t length)
+{
+    if (length < 0) {
+        length = str_get_len(prefix);
+    }
+
+    return str->length >= length && memcmp(str->value, prefix, length) == 0;
+}
+
+bool str_ends_with_str(const Str *str, const char *suffix, int64_t length)
+{
+    if (length < 0) {
+        length = str_get_len(suffix);
+    }
+
+    return str->length >= length && memcmp(STR_TAIL_P(str) - length, suffix, length) == 0;
+}
+
+bool str_append_char(Str *str, char c)
+{
+    if (str_ensure_capacity(str, str->length + 2)) {
+        STR_STAT_ADD(STR_STAT_APPENDED_BYTES, 1);
+        str->value[str->length++] = c;
+        str->value[str->length] = '\0';
+        str->hash = 0;
+        return true;
+    }
+
+    return false;
+}
+
+bool str_append_str(Str *str, const char *s, int64_t len)
+{
+    if (len < 0) {
+        len = str_get_len(s);
+    }
+
+    int64_t new_length = str->length + len;
+    if (str_ensure_capacity(str, new_length + 1)) {
+        STR_STAT_ADD(STR_STAT_APPENDED_BYTES, len);
+        memcpy(STR_TAIL_P(str), s, len);
+        str->value[new_length] = '\0';
+        str->length = new_length;
+        str->hash = 0;
+        return true;
+    }
+
+    return false;
+}
+
+bool str_append_many(Str *str, const StrView *views, int64_t count)
+{
+    StrView separator = {"", 0};
+    return str_join(str, views, count, separator);
+}
+
+bool str_join(Str *str, const StrView *parts, int64_t count, StrView separator)
+{
+    if (count <= 0) {
+        return true;
+    }
+
+    int64_t length = str->length + separator.length * (count - 1);
+
+    for (int64_t i = 0; i < count; i++) {
+        length += parts[i].length;
+    }
+
+    if (!str_ensure_capacity(str, length + 1)) {
+        return false;
+    }
+
+    char *p = STR_TAIL_P(str);
+
+    memcpy(p, parts[0].value, parts[0].length);
+    p += parts[0].length;
+
+    for (int64_t i = 1; i < count; i++) {
+        if (separator.length > 0) {
+            memcpy(p, separator.value, separator.length);
+            p += separator.length;
+        }
+
+        memcpy(p, parts[i].value, parts[i].length);
+        p += parts[i].length;
+    }
+
+    *p = '\0';
+    STR_STAT_ADD(STR_STAT_APPENDED_BYTES, length - str->length);
+    str->length = length;
+    str->hash = 0;
+    return true;
+}
+
+bool str_append_vformat(Str *str, const char *format, va_list args)
+{
+    if (!str_detach(str)) {
+        return false;
+    }
+
+    va_list copy;
+    int64_t available = str->size - str->length;
+
+    /* Optimistically format into the spare capacity */
+    va_copy(copy, args);
+    int length = vsnprintf(STR_TAIL_P(str), available, format, copy);
+    va_end(copy);
+
+    if (length >= 0 && length < available) {
+        STR_STAT_ADD(STR_STAT_APPENDED_BYTES, length);
+        str->length += length;
+        str->hash = 0;
+        return true;
+    }
+
+    /* The output did not fit: grow to the exact size and format again */
+    if (length >= 0 && str_ensure_capacity(str, str->length + length + 1)) {
+        va_copy(copy, args);
+        int written = vsnprintf(STR_TAIL_P(str), str->size - str->length, format, copy);
+        va_end(copy);
+
+        if (written == length) {
+            STR_STAT_ADD(STR_STAT_APPENDED_BYTES, length);
+            str->length += length;
+            str->hash = 0;
+            return true;
+        }
+    }
+
+    /* Restore \0 if vsnprintf() removed it */
+    str->value[str->length] = '\0';
+    return false;
+}
+
+bool str_append_format(Str *str, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+
+    bool result = str_append_vformat(str, format, args);
+
+    va_end(args);
+    return result;
+}
+
+static const char str_digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+/**
+ * Counts the decimal digits of n.
+ */
+static int str_count_digits(uint64_t n)
+{
+    int digits = 1;
+
+    for (;;) {
+        if (n < 10) {
+            return digits;
+        }
+
+        if (n < 100) {
+            return digits + 1;
+        }
+
+        if (n < 1000) {
+            return digits + 2;
+        }
+
+        if (n < 10000) {
+            return digits + 3;
+        }
+
+        n /= 10000;
+        digits += 4;
+    }
+}
+
+/**
+ * Writes the decimal digits of n backwards, two at a time, ending right before the given pointer.
+ */
+static void str_write_decimal(char *end, uint64_t n)
+{
+    while (n >= 100) {
+        const char *pair = str_digit_pairs + (n % 100) * 2;
+        n /= 100;
+        *--end = pair[1];
+        *--end = pair[0];
+    }
+
+    if (n >= 10) {
+        const char *pair = str_digit_pairs + n * 2;
+        *--end = pair[1];
+        *--end = pair[0];
+    } else {
+        *--end = (char) ('0' + n);
+    }
+}
+
+/**
+ * Returns the number of bits per digit of a power-of-two format, or 0 for decimal.
+ */
+static int str_int_format_shift(StrIntFormat format)
+{
+    switch (format) {
+        case STR_INT_HEX:
+        case STR_INT_HEX_UPPER:
+            return 4;
+        case STR_INT_OCTAL:
+            return 3;
+        case STR_INT_BINARY:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * Appends an integer given as sign and magnitude. The digits are written straight into the tail of the string
+ * after a single capacity check.
+ */
+static bool str_append_integer(Str *str, uint64_t magnitude, bool negative, StrIntFormat format, int width, StrPadOptions pad)
+{
+    const int shift = str_int_format_shift(format);
+    int digits;
+
+    if (shift == 0) {
+        digits = str_count_digits(magnitude);
+    } else {
+        digits = 1;
+        while (digits * shift < 64 && (magnitude >> (digits * shift)) != 0) {
+            digits++;
+        }
+    }
+
+    const int64_t length = digits + negative;
+    const int64_t padding = width > length ? width - length : 0;
+
+    if (!str_ensure_capacity(str, str->length + length + padding + 1)) {
+        return false;
+    }
+
+    char *p = STR_TAIL_P(str);
+
+    if (pad == STR_PAD_SPACE) {
+        memset(p, ' ', padding);
+        p += padding;
+    }
+
+    if (negative) {
+        *p++ = '-';
+    }
+
+    if (pad == STR_PAD_ZERO) {
+        memset(p, '0', padding);
+        p += padding;
+    }
+
+    if (shift == 0) {
+        str_write_decimal(p + digits, magnitude);
+    } else {
+        const char *alphabet = format == STR_INT_HEX_UPPER ? "0123456789ABCDEF" : "0123456789abcdef";
+        const uint64_t mask = ((uint64_t) 1 << shift) - 1;
+
+        for (int i = digits - 1; i >= 0; i--) {
+            p[i] = alphabet[magnitude & mask];
+            magnitude >>= shift;
+        }
+    }
+
+    str->length = (int64_t) (p + digits - str->value);
+    str->value[str->length] = '\0';
+    str->hash = 0;
+    return true;
+}
+
+bool str_append_int(Str *str, int64_t value)
+{
+    return str_append_integer(str, value < 0 ? ~((uint64_t) value) + 1 : (uint64_t) value, value < 0, STR_INT_DECIMAL, 0, STR_PAD_SPACE);
+}
+
+bool str_append_uint(Str *str, uint64_t value)
+{
+    return str_append_integer(str, value, false, STR_INT_DECIMAL, 0, STR_PAD_SPACE);
+}
+
+bool str_append_int_format(Str *str, int64_t value, StrIntFormat format, int width, StrPadOptions pad)
+{
+    return str_append_integer(str, value < 0 ? ~((uint64_t) value) + 1 : (uint64_t) value, value < 0, format, width, pad);
+}
+
+bool str_append_uint_format(Str *str, uint64_t value, StrIntFormat format, int width, StrPadOptions pad)
+{
+    return str_append_integer(str, value, false, format, width, pad);
+}
+
+/**
+ * A floating point number with a 64-bit significand: f * 2^e. Used by the Grisu3 algorithm.
+ */
+typedef struct StrDiyFp
+{
+    uint64_t f;
+    int e;
+} StrDiyFp;
+
+/**
+ * Normalized approximations of 10^k for k = -348, -340, ..., 340.
+ */
+static const StrDiyFp str_cached_powers[87] = {
+    {0xfa8fd5a0081c0288ULL, -1220}, {0xbaaee17fa23ebf76ULL, -1193}, {0x8b16fb203055ac76ULL, -1166},
+    {0xcf42894a5dce35eaULL, -1140}, {0x9a6bb0aa55653b2dULL, -1113}, {0xe61acf033d1a45dfULL, -1087},
+    {0xab70fe17c79ac6caULL, -1060}, {0xff77b1fcbebcdc4fULL, -1034}, {0xbe5691ef416bd60cULL, -1007},
+    {0x8dd01fad907ffc3cULL, -980}, {0xd3515c2831559a83ULL, -954}, {0x9d71ac8fada6c9b5ULL, -927},
+    {0xea9c227723ee8bcbULL, -901}, {0xaecc49914078536dULL, -874}, {0x823c12795db6ce57ULL, -847},
+    {0xc21094364dfb5637ULL, -821}, {0x9096ea6f3848984fULL, -794}, {0xd77485cb25823ac7ULL, -768},
+    {0xa086cfcd97bf97f4ULL, -741}, {0xef340a98172aace5ULL, -715}, {0xb23867fb2a35b28eULL, -688},
+    {0x84c8d4dfd2c63f3bULL, -661}, {0xc5dd44271ad3cdbaULL, -635}, {0x936b9fcebb25c996ULL, -608},
+    {0xdbac6c247d62a584ULL, -582}, {0xa3ab66580d5fdaf6ULL, -555}, {0xf3e2f893dec3f126ULL, -529},
+    {0xb5b5ada8aaff80b8ULL, -502}, {0x87625f056c7c4a8bULL, -475}, {0xc9bcff6034c13053ULL, -449},
+    {0x964e858c91ba2655ULL, -422}, {0xdff9772470297ebdULL, -396}, {0xa6dfbd9fb8e5b88fULL, -369},
+    {0xf8a95fcf88747d94ULL, -343}, {0xb94470938fa89bcfULL, -316}, {0x8a08f0f8bf0f156bULL, -289},
+    {0xcdb02555653131b6ULL, -263}, {0x993fe2c6d07b7facULL, -236}, {0xe45c10c42a2b3b06ULL, -210},
+    {0xaa242499697392d3ULL, -183}, {0xfd87b5f28300ca0eULL, -157}, {0xbce5086492111aebULL, -130},
+    {0x8cbccc096f5088ccULL, -103}, {0xd1b71758e219652cULL, -77}, {0x9c40000000000000ULL, -50},
+    {0xe8d4a51000000000ULL, -24}, {0xad78ebc5ac620000ULL, 3}, {0x813f3978f8940984ULL, 30},
+    {0xc097ce7bc90715b3ULL, 56}, {0x8f7e32ce7bea5c70ULL, 83}, {0xd5d238a4abe98068ULL, 109},
+    {0x9f4f2726179a2245ULL, 136}, {0xed63a231d4c4fb27ULL, 162}, {0xb0de65388cc8ada8ULL, 189},
+    {0x83c7088e1aab65dbULL, 216}, {0xc45d1df942711d9aULL, 242}, {0x924d692ca61be758ULL, 269},
+    {0xda01ee641a708deaULL, 295}, {0xa26da3999aef774aULL, 322}, {0xf209787bb47d6b85ULL, 348},
+    {0xb454e4a179dd1877ULL, 375}, {0x865b86925b9bc5c2ULL, 402}, {0xc83553c5c8965d3dULL, 428},
+    {0x952ab45cfa97a0b3ULL, 455}, {0xde469fbd99a05fe3ULL, 481}, {0xa59bc234db398c25ULL, 508},
+    {0xf6c69a72a3989f5cULL, 534}, {0xb7dcbf5354e9beceULL, 561}, {0x88fcf317f22241e2ULL, 588},
+    {0xcc20ce9bd35c78a5ULL, 614}, {0x98165af37b2153dfULL, 641}, {0xe2a0b5dc971f303aULL, 667},
+    {0xa8d9d1535ce3b396ULL, 694}, {0xfb9b7cd9a4a7443cULL, 720}, {0xbb764c4ca7a44410ULL, 747},
+    {0x8bab8eefb6409c1aULL, 774}, {0xd01fef10a657842cULL, 800}, {0x9b10a4e5e9913129ULL, 827},
+    {0xe7109bfba19c0c9dULL, 853}, {0xac2820d9623bf429ULL, 880}, {0x80444b5e7aa7cf85ULL, 907},
+    {0xbf21e44003acdd2dULL, 933}, {0x8e679c2f5e44ff8fULL, 960}, {0xd433179d9c8cb841ULL, 986},
+    {0x9e19db92b4e31ba9ULL, 1013}, {0xeb96bf6ebadf77d9ULL, 1039}, {0xaf87023b9bf0ee6bULL, 1066},
+};
+
+static const uint32_t str_pow10_u32[10] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+/**
+ * Multiplies two DiyFp values, keeping the rounded upper 64 bits of the product.
+ */
+static StrDiyFp str_diyfp_multiply(StrDiyFp x, StrDiyFp y)
+{
+    const uint64_t mask = 0xffffffffu;
+    const uint64_t a = x.f >> 32, b = x.f & mask, c = y.f >> 32, d = y.f & mask;
+    const uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    uint64_t tmp = (bd >> 32) + (ad & mask) + (bc & mask);
+
+    tmp += 1u << 31;
+    StrDiyFp r = {ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), x.e + y.e + 64};
+    return r;
+}
+
+static StrDiyFp str_diyfp_normalize(StrDiyFp x)
+{
+    while (!(x.f & ((uint64_t) 1 << 63))) {
+        x.f <<= 1;
+        x.e--;
+    }
+
+    return x;
+}
+
+/**
+ * Moves the last digit of the buffer towards the exact value while it stays inside the unsafe interval, then
+ * checks that the result is the closest shortest candidate despite the imprecision of unit in the scaled values.
+ * Returns false if that cannot be decided.
+ */
+static bool str_grisu_round_weed(char *buffer, int length, uint64_t distance_too_high_w, uint64_t unsafe_interval,
+                                 uint64_t rest, uint64_t ten_kappa, uint64_t unit)
+{
+    const uint64_t small_distance = distance_too_high_w - unit;
+    const uint64_t big_distance = distance_too_high_w + unit;
+
+    while (rest < small_distance && unsafe_interval - rest >= ten_kappa &&
+           (rest + ten_kappa < small_distance || small_distance - rest >= rest + ten_kappa - small_distance)) {
+        buffer[length - 1]--;
+        rest += ten_kappa;
+    }
+
+    /* The next candidate may be closer to the exact value */
+    if (rest < big_distance && unsafe_interval - rest >= ten_kappa &&
+        (rest + ten_kappa < big_distance || big_distance - rest > rest + ten_kappa - big_distance)) {
+        return false;
+    }
+
+    /* The candidate must be inside the safe interval */
+    return 2 * unit <= rest && rest <= unsafe_interval - 4 * unit;
+}
+
+/**
+ * Generates the shortest digits of a positive, finite, non-zero double with the Grisu3 algorithm.
+ * The value is buffer * 10^k, with length digits (at most 17). Returns false for the roughly 0.5% of values for
+ * which the 64-bit approximation cannot prove that the digits are the shortest and closest ones.
+ */
+static bool str_grisu3(double value, char *buffer, int *length, int *k)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    const int biased_e = (int) ((bits >> 52) & 0x7ff);
+    const uint64_t hidden = (uint64_t) 1 << 52;
+    StrDiyFp v = {bits & (hidden - 1), biased_e ? biased_e - 1075 : -1074};
+
+    if (biased_e) {
+        v.f |= hidden;
+    }
+
+    /* Boundaries m- and m+ of the rounding interval, with the exponent of the normalized value */
+    StrDiyFp plus = str_diyfp_normalize((StrDiyFp) {(v.f << 1) + 1, v.e - 1});
+    StrDiyFp minus = v.f == hidden && biased_e > 1 ? (StrDiyFp) {(v.f << 2) - 1, v.e - 2}
+                                                   : (StrDiyFp) {(v.f << 1) - 1, v.e - 1};
+    minus.f <<= minus.e - plus.e;
+    minus.e = plus.e;
+
+    /* Pick a cached power of ten that brings the exponent into [-60, -32] */
+    const double dk = (-61 - plus.e) * 0.30102999566398114 + 347;
+    int ck = (int) dk;
+    if (dk - ck > 0.0) {
+        ck++;
+    }
+
+    const int index = (ck >> 3) + 1;
+    const StrDiyFp c_mk = str_cached_powers[index];
+    *k = -(-348 + index * 8);
+
+    /* Each scaled value is off by less than one unit: widen the interval by a unit on both sides */
+    const StrDiyFp w = str_diyfp_multiply(str_diyfp_normalize(v), c_mk);
+    const StrDiyFp too_high = {str_diyfp_multiply(plus, c_mk).f + 1, w.e};
+    const StrDiyFp too_low = {str_diyfp_multiply(minus, c_mk).f - 1, w.e};
+    const StrDiyFp one = {(uint64_t) 1 << -w.e, w.e};
+    uint64_t unsafe_interval = too_high.f - too_low.f;
+    uint64_t unit = 1;
+
+    /* Generate digits from too_high until the rest falls inside the interval */
+    uint32_t integrals = (uint32_t) (too_high.f >> -one.e);
+    uint64_t fractionals = too_high.f & (one.f - 1);
+    int kappa = 0;
+
+    while (kappa < 10 && integrals >= str_pow10_u32[kappa]) {
+        kappa++;
+    }
+
+    *length = 0;
+
+    while (kappa > 0) {
+        const uint32_t divisor = str_pow10_u32[kappa - 1];
+
+        buffer[(*length)++] = (char) ('0' + integrals / divisor);
+        integrals %= divisor;
+        kappa--;
+
+        const uint64_t rest = ((uint64_t) integrals << -one.e) + fractionals;
+        if (rest < unsafe_interval) {
+            *k += kappa;
+            return str_grisu_round_weed(buffer, *length, too_high.f - w.f, unsafe_interval, rest,
+                                        (uint64_t) divisor << -one.e, unit);
+        }
+    }
+
+    for (;;) {
+        fractionals *= 10;
+        unit *= 10;
+        unsafe_interval *= 10;
+
+        buffer[(*length)++] = (char) ('0' + (fractionals >> -one.e));
+        fractionals &= one.f - 1;
+        kappa--;
+
+        if (fractionals < unsafe_interval) {
+            *k += kappa;
+            return str_grisu_round_weed(buffer, *length, (too_high.f - w.f) * unit, unsafe_interval, fractionals,
+                                        one.f, unit);
+        }
+    }
+}
+
+/**
+ * Returns true if a boundary of the rounding interval of m * 2^e may have fewer than length significant digits,
+ * where the value has n digits before the decimal point. Grisu3 excludes the boundaries, but they parse back to the
+ * value when m is even; only integer boundaries that end in zeros can be shorter than the Grisu3 digits.
+ */
+static bool str_boundary_may_be_shorter(uint64_t m, int e, bool lower_closer, int length, int n)
+{
+    if ((m & 1) || e < 2) {
+        return false;
+    }
+
+    const uint64_t odd[2] = {2 * m + 1, lower_closer ? 4 * m - 1 : 2 * m - 1};
+    const int twos[2] = {e - 1, lower_closer ? e - 2 : e - 1};
+
+    for (int i = 0; i < 2; i++) {
+        /* The boundary odd * 2^twos ends in as many zeros as it has factors of both 2 and 5 */
+        int zeros = 0;
+        for (uint64_t q = odd[i]; zeros < twos[i] && q % 5 == 0; q /= 5) {
+            zeros++;
+        }
+
+        if (zeros > 0 && n - 1 - zeros < length) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static int str_shortest_exact(uint64_t m, int e, bool lower_closer, char *buffer, int *k);
+
+/**
+ * Appends "nan", "inf" or "-inf" like printf() does. Returns false if the value is finite.
+ */
+static bool str_append_non_finite(Str *str, double value, bool *result)
+{
+    if (value != value) {
+        *result = str_append_str(str, "nan", 3);
+        return true;
+    }
+
+    if (value == HUGE_VAL || value == -HUGE_VAL) {
+        *result = value < 0 ? str_append_str(str, "-inf", 4) : str_append_str(str, "inf", 3);
+        return true;
+    }
+
+    return false;
+}
+
+#ifdef __SIZEOF_INT128__
+/**
+ * Formats a double with a fixed number of decimals like printf("%.*f"), rounding the exact binary value half to
+ * even. Only values whose scaled representation fits in 128 bits are handled; returns false for the others.
+ */
+static bool str_append_fixed(Str *str, double value, int precision, bool *result)
+{
+    static const uint64_t pow10[20] = {
+        1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL,
+        1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+        100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL,
+        1000000000000000000ULL, 10000000000000000000ULL
+    };
+    uint64_t bits;
+    unsigned __int128 q;
+    char buffer[64];
+
+    if (precision > 22) {
+        return false;
+    }
+
+    memcpy(&bits, &value, sizeof(bits));
+
+    const int biased_e = (int) ((bits >> 52) & 0x7ff);
+    const uint64_t hidden = (uint64_t) 1 << 52;
+    const uint64_t m = (bits & (hidden - 1)) | (biased_e ? hidden : 0);
+    const int e = biased_e ? biased_e - 1075 : -1074;
+
+    /* q holds the value scaled by 10^scale; the decimals past the scale are zeros */
+    int scale = 0;
+
+    if (m == 0) {
+        q = 0;
+    } else if (e >= 0) {
+        if (e > 74) {
+            return false;
+        }
+
+        q = (unsigned __int128) m << e;
+    } else {
+        const int shift = -e;
+        if (shift > 127) {
+            return false;
+        }
+
+        /* m * 10^precision < 2^53 * 10^22 < 2^127 */
+        unsigned __int128 scaled = m;
+        if (precision > 19) {
+            scaled *= pow10[19];
+            scaled *= pow10[precision - 19];
+        } else {
+            scaled *= pow10[precision];
+        }
+
+        const unsigned __int128 remainder = scaled & (((unsigned __int128) 1 << shift) - 1);
+        const unsigned __int128 half = (unsigned __int128) 1 << (shift - 1);
+
+        q = scaled >> shift;
+        if (remainder > half || (remainder == half && (q & 1))) {
+            q++;
+        }
+
+        scale = precision;
+    }
+
+    /* Write the digits of q backwards, at least scale + 1 of them */
+    char *end = buffer + sizeof(buffer);
+    char *p = end;
+
+    while (q > UINT64_MAX) {
+        uint64_t chunk = (uint64_t) (q % pow10[19]);
+        q /= pow10[19];
+
+        for (int i = 0; i < 19; i++) {
+            *--p = (char) ('0' + chunk % 10);
+            chunk /= 10;
+        }
+    }
+
+    uint64_t low = (uint64_t) q;
+    do {
+        *--p = (char) ('0' + low % 10);
+        low /= 10;
+    } while (low > 0);
+
+    while (end - p < scale + 1) {
+        *--p = '0';
+    }
+
+    const int64_t digits = end - p;
+    const int64_t length = digits - scale + (bits >> 63) + (precision > 0) + precision;
+
+    if (!str_ensure_capacity(str, str->length + length + 1)) {
+        *result = false;
+        return true;
+    }
+
+    char *out = STR_TAIL_P(str);
+    if (bits >> 63) {
+        *out++ = '-';
+    }
+
+    memcpy(out, p, digits - scale);
+    out += digits - scale;
+
+    if (precision > 0) {
+        *out++ = '.';
+        memcpy(out, end - scale, scale);
+        memset(out + scale, '0', precision - scale);
+    }
+
+    str->length += length;
+    str->value[str->length] = '\0';
+    str->hash = 0;
+    *result = true;
+    return true;
+}
+#endif
+
+bool str_append_float(Str *str, double value, int precision)
+{
+    bool result;
+
+    if (precision < 0) {
+        /* Same as printf(): a negative precision is taken as if it was omitted */
+        precision = 6;
+    }
+
+    if (str_append_non_finite(str, value, &result)) {
+        return result;
+    }
+
+#ifdef __SIZEOF_INT128__
+    if (str_append_fixed(str, value, precision, &result)) {
+        return result;
+    }
+#endif
+
+    return str_append_format(str, "%.*f", precision, value);
+}
+
+bool str_append_float_shortest(Str *str, double value)
+{
+    bool result;
+    char digits[18];
+    int k;
+
+    if (str_append_non_finite(str, value, &result)) {
+        return result;
+    }
+
+    const bool negative = signbit(value);
+    if (value == 0) {
+        return negative ? str_append_str(str, "-0", 2) : str_append_char(str, '0');
+    }
+
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    const int biased_e = (int) ((bits >> 52) & 0x7ff);
+    const uint64_t hidden = (uint64_t) 1 << 52;
+    const uint64_t m = (bits & (hidden - 1)) | (biased_e ? hidden : 0);
+    const int e = biased_e ? biased_e - 1075 : -1074;
+    const bool lower_closer = m == hidden && biased_e > 1;
+    int length;
+
+    if (!str_grisu3(negative ? -value : value, digits, &length, &k) ||
+        str_boundary_may_be_shorter(m, e, lower_closer, length, length + k)) {
+        length = str_shortest_exact(m, e, lower_closer, digits, &k);
+    }
+
+    const int n = length + k;
+
+    /* Worst case: sign, "0.", 5 zeros and 17 digits, or 17 digits and "e-308" */
+    if (!str_ensure_capacity(str, str->length + 32)) {
+        return false;
+    }
+
+    char *p = STR_TAIL_P(str);
+    if (negative) {
+        *p++ = '-';
+    }
+
+    if (length <= n && n <= 21) {
+        /* Integer: digits followed by zeros */
+        memcpy(p, digits, length);
+        memset(p + length, '0', n - length);
+        p += n;
+    } else if (0 < n && n <= 21) {
+        /* Decimal point inside the digits */
+        memcpy(p, digits, n);
+        p[n] = '.';
+        memcpy(p + n + 1, digits + n, length - n);
+        p += length + 1;
+    } else if (-6 < n && n <= 0) {
+        /* Leading zeros after the decimal point */
+        *p++ = '0';
+        *p++ = '.';
+        memset(p, '0', -n);
+        memcpy(p - n, digits, length);
+        p += length - n;
+    } else {
+        /* Exponential notation */
+        int exponent = n - 1;
+
+        *p++ = digits[0];
+        if (length > 1) {
+            *p++ = '.';
+            memcpy(p, digits + 1, length - 1);
+            p += length - 1;
+        }
+
+        *p++ = 'e';
+        *p++ = exponent < 0 ? '-' : '+';
+        exponent = exponent < 0 ? -exponent : exponent;
+
+        const int exponent_digits = str_count_digits((uint64_t) exponent);
+        str_write_decimal(p + exponent_digits, (uint64_t) exponent);
+        p += exponent_digits;
+    }
+
+    str->length = (int64_t) (p - str->value);
+    str->value[str->length] = '\0';
+    str->hash = 0;
+    return true;
+}
+
+void str_to_lower(Str *str)
+{
+    if (!str_detach(str)) {
+        return;
+    }
+
+    str_ascii_case_convert(str->value, str->length, 'A');
+    str->hash = 0;
+}
+
+void str_to_upper(Str *str)
+{
+    if (!str_detach(str)) {
+        return;
+    }
+
+    str_ascii_case_convert(str->value, str->length, 'a');
+    str->hash = 0;
+}
+
+void str_trim(Str *str, StrTrimOptions options)
+{
+    str_trim_charset(str, &str_whitespace, options);
+}
+
+void str_trim_chars(Str *str, const char *chars, int64_t length, StrTrimOptions options)
+{
+    StrCharSet set;
+    str_charset_init(&set, chars, length);
+    str_trim_charset(str, &set, options);
+}
+
+void str_trim_charset(Str *str, const StrCharSet *set, StrTrimOptions options)
+{
+    StrView trimmed = str_view_trim_charset(str_view(str), set, options);
+    const int64_t offset = trimmed.value - str->value;
+
+    if (trimmed.length == str->length || !str_detach(str)) {
+        return;
+    }
+
+    if (offset > 0) {
+        STR_STAT_ADD(STR_STAT_TRIMMED_BYTES, trimmed.length);
+        memmove(str->value, str->value + offset, trimmed.length);
+    }
+
+    str->length = trimmed.length;
+    str->value[str->length] = '\0';
+    str->hash = 0;
+}
+
+int64_t str_replace_str(Str *str, const char *search, int64_t search_length, const char *replacement, int64_t replacement_length, int64_t limit)
+{
+    if (search_length < 0) {
+        search_length = str_get_len(search);
+    }
+
+    if (replacement_length < 0) {
+        replacement_length = str_get_len(replacement);
+    }
+
+    if (search_length == 0 || limit == 0) {
+        return 0;
+    }
+
+    /* A shared buffer is only copied when there is something to replace */
+    if (str_is_shared(str)) {
+        if (str_memnstr(str->value, str->length, search, search_length) == NULL) {
+            return 0;
+        }
+
+        if (!str_detach(str)) {
+            return -1;
+        }
+    }
+
+    const int64_t max = limit < 0 ? INT64_MAX : limit;
+    char *s = str->value;
+    char *e = STR_TAIL_P(str);
+    int64_t count = 0;
+
+    if (replacement_length == search_length) {
+        /* Same length: overwrite each occurrence */
+        while (count < max && (s = str_memnstr(s, e - s, search, search_length)) != NULL) {
+            memcpy(s, replacement, replacement_length);
+            s += search_length;
+            count++;
+        }
+    } else if (replacement_length < search_length) {
+        /* Shorter: compact the string in a single pass, the write position never passes the read position */
+        char *w = s;
+
+        while (count < max) {
+            char *match = str_memnstr(s, e - s, search, search_length);
+            if (match == NULL) {
+                break;
+            }
+
+            memmove(w, s, match - s);
+            w += match - s;
+            memcpy(w, replacement, replacement_length);
+            w += replacement_length;
+            s = match + search_length;
+            count++;
+        }
+
+        memmove(w, s, e - s);
+        str->length = (w + (e - s)) - str->value;
+    } else {
+        /* Longer: count the occurrences to grow once to the exact size */
+        for (char *p = s; count < max && (p = str_memnstr(p, e - p, search, search_length)) != NULL; p += search_length) {
+            count++;
+        }
+
+        if (count == 0) {
+            return 0;
+        }
+
+        const int64_t growth = count * (replacement_length - search_length);
+        const int64_t length = str->length;
+
+        if (!str_ensure_capacity(str, length + growth + 1)) {
+            return -1;
+        }
+
+        /*
+         * Move the string to the end of the new size and rebuild it from the front. Before each occurrence the
+         * write position trails the read position by the growth still to come, so unread bytes are never
+         * overwritten.
+         */
+        char *w = str->value;
+        s = str->value + growth;
+        e = s + length;
+        memmove(s, str->value, length);
+
+        for (int64_t i = 0; i < count; i++) {
+            char *match = str_memnstr(s, e - s, search, search_length);
+
+            memmove(w, s, match - s);
+            w += match - s;
+            memcpy(w, replacement, replacement_length);
+            w += replacement_length;
+            s = match + search_length;
+        }
+
+        memmove(w, s, e - s);
+        str->length = length + growth;
+    }
+
+    if (count > 0) {
+        str->value[str->length] = '\0';
+        str->hash = 0;
+    }
+
+    return count;
+}
+
+bool str_repeat(Str *str, int multiply)
+{
+    if (multiply < 0) {
+        return false;
+    }
+
+    if (multiply == 0 || str->length == 0) {
+        if (!str_detach(str)) {
+            return false;
+        }
+
+        // Truncate to empty
+        str->value[0] = '\0';
+        str->length = 0;
+        str->hash = 0;
+        return true;
+    }
+
+    int64_t length = str->length * multiply;
+    if (str_ensure_capacity(str, length + 1)) {
+        STR_STAT_ADD(STR_STAT_REPEATED_BYTES, length - str->length);
+
+        if (str->length == 1) {
+            memset(str->value, str->value[0], length);
+        } else {
+            char *s = STR_TAIL_P(str);
+            const char *e = str->value + length;
+
+            while (s < e) {
+                memmove(s, str->value, str->length);
+                s += str->length;
+            }
+        }
+
+        str->value[length] = '\0';
+        str->length = length;
+        str->hash = 0;
+        return true;
+    }
+
+    return false;
+}
+
+
+/**
+ * Computes the critical factorization of the needle for the Two-Way algorithm.
+ * Returns the position of the maximal suffix and stores its period.
+ */
+static int64_t str_maximal_suffix(const unsigned char *n, int64_t length, bool reverse, int64_t *period)
+{
+    int64_t ip = -1;
+    int64_t jp = 0;
+    int64_t k = 1;
+    int64_t p = 1;
+
+    while (jp + k < length) {
+        unsigned char a = n[ip + k];
+        unsigned char b = n[jp + k];
+
+        if (a == b) {
+            if (k == p) {
+                jp += p;
+                k = 1;
+            } else {
+                k++;
+            }
+        } else if (reverse ? a < b : a > b) {
+            jp += k;
+            k = 1;
+            p = jp - ip;
+        } else {
+            ip = jp++;
+            k = p = 1;
+        }
+    }
+
+    *period = p;
+    return ip;
+}
+
+static int64_t str_two_way_search(const StrSearcher *searcher, const unsigned char *h, int64_t h_len)
+{
+    const unsigned char *n = (const unsigned char *) searcher->needle;
+    const int64_t l = searcher->length;
+    const int64_t ms = searcher->critical;
+    int64_t mem = 0;
+    int64_t pos = 0;
+
+    while (pos <= h_len - l) {
+        const unsigned char *w = h + pos;
+        int64_t k = searcher->shift[w[l - 1]];
+
+        /* Skip using the last byte of the window */
+        if (k) {
+            pos += MAX(k, mem);
+            mem = 0;
+            continue;
+        }
+
+        /* Compare the right half */
+        for (k = MAX(ms + 1, mem); k < l && n[k] == w[k]; k++);
+        if (k < l) {
+            pos += k - ms;
+            mem = 0;
+            continue;
+        }
+
+        /* Compare the left half */
+        for (k = ms + 1; k > mem && n[k - 1] == w[k - 1]; k--);
+        if (k <= mem) {
+            return pos;
+        }
+
+        pos += searcher->period;
+        mem = searcher->memory;
+    }
+
+    return -1;
+}
+
+static int64_t str_raita_search(const StrSearcher *searcher, const unsigned char *h, int64_t h_len)
+{
+    const unsigned char *n = (const unsigned char *) searcher->needle;
+    const int64_t last = searcher->length - 1;
+    const int64_t middle = searcher->length / 2;
+    int64_t pos = 0;
+
+    while (pos <= h_len - searcher->length) {
+        const unsigned char c = h[pos + last];
+
+        if (c == n[last] && h[pos] == n[0] && h[pos + middle] == n[middle] &&
+            memcmp(h + pos + 1, n + 1, last - 1) == 0) {
+            return pos;
+        }
+
+        pos += searcher->shift[c];
+    }
+
+    return -1;
+}
+
+/**
+ * Returns the index of the first occurrence of the needle in the string.
+ */
+static int64_t str_searcher_find(const StrSearcher *searcher, const char *s, int64_t length)
+{
+    const char *r;
+
+    if (length < searcher->length) {
+        return -1;
+    }
+
+    switch (searcher->algorithm) {
+        case STR_SEARCH_BYTE:
+            r = memchr(s, *searcher->needle, length);
+            return r ? (int64_t) (r - s) : -1;
+        case STR_SEARCH_VECTOR:
+            r = str_memnstr_impl((char *) s, length, searcher->needle, searcher->length);
+            return r ? (int64_t) (r - s) : -1;
+        case STR_SEARCH_RAITA:
+            return str_raita_search(searcher, (const unsigned char *) s, length);
+        default:
+            return str_two_way_search(searcher, (const unsigned char *) s, length);
+    }
+}
+
+bool str_searcher_init_str(StrSearcher *searcher, const char *needle, int64_t length)
+{
+    if (length < 0) {
+        length = str_get_len(needle);
+    }
+
+    if (length == 0) {
+        return false;
+    }
+
+    char *mem = malloc(sizeof(char) * length);
+    if (mem == NULL) {
+        return false;
+    }
+
+    memcpy(mem, needle, length);
+    searcher->needle = mem;
+    searcher->length = length;
+    searcher->critical = 0;
+    searcher->period = 0;
+    searcher->memory = 0;
+
+    const unsigned char *n = (const unsigned char *) mem;
+
+    /* Shifts used by str_searcher_last_indexof_str(): distance to the first occurrence after n[0] */
+    for (int i = 0; i < 256; i++) {
+        searcher->reverse_shift[i] = length;
+    }
+
+    for (int64_t i = length - 1; i > 0; i--) {
+        searcher->reverse_shift[n[i]] = i;
+    }
+
+    if (length == 1) {
+        searcher->algorithm = STR_SEARCH_BYTE;
+    } else if (length < STR_SEARCHER_RAITA_MIN) {
+        searcher->algorithm = STR_SEARCH_VECTOR;
+    } else if (length < STR_SEARCHER_TWO_WAY_MIN) {
+        searcher->algorithm = STR_SEARCH_RAITA;
+
+        /* Horspool bad character shifts, the last byte is excluded */
+        for (int i = 0; i < 256; i++) {
+            searcher->shift[i] = length;
+        }
+
+        for (int64_t i = 0; i < length - 1; i++) {
+            searcher->shift[n[i]] = length - 1 - i;
+        }
+    } else {
+        searcher->algorithm = STR_SEARCH_TWO_WAY;
+
+        /* Distance from the last occurrence of each byte to the end of the needle, the last byte included */
+        for (int i = 0; i < 256; i++) {
+            searcher->shift[i] = length;
+        }
+
+        for (int64_t i = 0; i < length; i++) {
+            searcher->shift[n[i]] = length - 1 - i;
+        }
+
+        int64_t p, q;
+        int64_t ms = str_maximal_suffix(n, length, false, &p);
+        int64_t ms_reverse = str_maximal_suffix(n, length, true, &q);
+
+        if (ms_reverse > ms) {
+            ms = ms_reverse;
+            p = q;
+        }
+
+        searcher->critical = ms;
+
+        if (memcmp(n, n + p, ms + 1) == 0) {
+            /* Periodic needle: remember the matched prefix after shifting by the period */
+            searcher->period = p;
+            searcher->memory = length - p;
+        } else {
+            searcher->period = MAX(ms, length - ms - 1) + 1;
+        }
+    }
+
+    return true;
+}
+
+void str_searcher_finalize(StrSearcher *searcher)
+{
+    if (searcher && searcher->needle) {
+        free(searcher->needle);
+        searcher->needle = NULL;
+        searcher->length = 0;
+    }
+}
+
+int64_t str_searcher_indexof_str(const StrSearcher *searcher, const char *s, int64_t length)
+{
+    if (length < 0) {
+        length = str_get_len(s);
+    }
+
+    return str_searcher_find(searcher, s, length);
+}
+
+int64_t str_searcher_last_indexof_str(const StrSearcher *searcher, const char *s, int64_t length)
+{
+    if (length < 0) {
+        length = str_get_len(s);
+    }
+
+    const unsigned char *h = (const unsigned char *) s;
+    const unsigned char *n = (const unsigned char *) searcher->needle;
+    int64_t pos = length - searcher->length;
+
+    /* Reverse Horspool: the window is shifted left based on its first byte */
+    while (pos >= 0) {
+        if (h[pos] == n[0] && memcmp(h + pos + 1, n + 1, searcher->length - 1) == 0) {
+            return pos;
+        }
+
+        pos -= searcher->reverse_shift[h[pos]];
+    }
+
+    return -1;
+}
+
+int64_t str_searcher_find_all_str(const StrSearcher *searcher, const char *s, int64_t length, int64_t *indexes, int64_t max)
+{
+    if (length < 0) {
+        length = str_get_len(s);
+    }
+
+    int64_t count = 0;
+    int64_t offset = 0;
+
+    for (;;) {
+        int64_t r = str_searcher_find(searcher, s + offset, length - offset);
+        if (r < 0) {
+            break;
+        }
+
+        if (count < max) {
+            indexes[count] = offset + r;
+        }
+
+        count++;
+        offset += r + searcher->length;
+    }
+
+    return count;
+}
+
+StrView str_view_str(const char *s, int64_t length)
+{
+    if (length < 0) {
+        length = str_get_len(s);
+    }
+
+    StrView view = {s, length};
+    return view;
+}
+
+StrView str_view_slice(StrView view, int64_t start, int64_t length)
+{
+    start = MIN(MAX(start, 0), view.length);
+
+    if (length < 0 || length > view.length - start) {
+        length = view.length - start;
+    }
+
+    StrView slice = {view.value + start, length};
+    return slice;
+}
+
+int str_view_compare(StrView a, StrView b)
+{
+    return str_memncmp(a.value, a.length, b.value, b.length);
+}
+
+bool str_view_equals(StrView a, StrView b)
+{
+    return a.length == b.length && memcmp(a.value, b.value, a.length) == 0;
+}
+
+int64_t str_view_indexof(StrView view, StrView needle)
+{
+    const char *r = str_memnstr((char *) view.value, view.length, needle.value, needle.length);
+    if (r) {
+        return (int64_t) (r - view.value);
+    } else {
+        return -1;
+    }
+}
+
+bool str_view_starts_with(StrView view, StrView prefix)
+{
+    return view.length >= prefix.length && memcmp(view.value, prefix.value, prefix.length) == 0;
+}
+
+bool str_view_ends_with(StrView view, StrView suffix)
+{
+    return view.length >= suffix.length &&
+           memcmp(view.value + view.length - suffix.length, suffix.value, suffix.length) == 0;
+}
+
+StrView str_view_trim(StrView view, StrTrimOptions options)
+{
+    return str_view_trim_charset(view, &str_whitespace, options);
+}
+
+StrView str_view_trim_charset(StrView view, const StrCharSet *set, StrTrimOptions options)
+{
+    const char *s = view.value;
+    const char *e = view.value + view.length;
+
+    if (options & STR_TRIM_LEFT) {
+        s = str_charset_span(set, s, e);
+    }
+
+    if (options & STR_TRIM_RIGHT) {
+        e = str_charset_span_reverse(set, s, e);
+    }
+
+    StrView trimmed = {s, e - s};
+    return trimmed;
+}
+
+void str_charset_init(StrCharSet *set, const char *chars, int64_t length)
+{
+    if (length < 0) {
+        length = str_get_len(chars);
+    }
+
+    memset(set, 0, sizeof(StrCharSet));
+
+    for (int64_t i = 0; i < length; i++) {
+        unsigned char b = (unsigned char) chars[i];
+
+        if (!str_charset_contains(set, chars[i])) {
+            set->bitmap[b >> 6] |= (uint64_t) 1 << (b & 63);
+
+            if (set->count < 16) {
+                set->chars[set->count] = chars[i];
+            }
+
+            set->count++;
+        }
+    }
+}
+
+void str_split_init(StrSplit *split, StrView source, const char *delimiters, int64_t length, int64_t limit, StrSplitOptions options)
+{
+    split->rest = source;
+    str_charset_init(&split->delimiters, delimiters, length);
+    split->limit = limit;
+    split->options = options;
+    split->done = false;
+}
+
+bool str_split_next(StrSplit *split, StrView *field)
+{
+    const char *s = split->rest.value;
+    const char *e = s + split->rest.length;
+
+    if (split->done) {
+        return false;
+    }
+
+    if (split->options & STR_SPLIT_SKIP_EMPTY) {
+        s = str_charset_span(&split->delimiters, s, e);
+
+        if (s == e) {
+            split->done = true;
+            return false;
+        }
+    }
+
+    const char *d = split->limit == 0 ? NULL : str_charset_find(&split->delimiters, s, e);
+    if (d == NULL) {
+        /* Last field */
+        field->value = s;
+        field->length = e - s;
+        split->done = true;
+        return true;
+    }
+
+    field->value = s;
+    field->length = d - s;
+    split->rest.value = d + 1;
+    split->rest.length = e - d - 1;
+
+    if (split->limit > 0) {
+        split->limit--;
+    }
+
+    return true;
+}
+
+int64_t str_split_into(StrView source, const char *delimiters, int64_t length, StrView *fields, int64_t max, StrSplitOptions options)
+{
+    StrSplit split;
+    int64_t count = 0;
+
+    if (max <= 0) {
+        return 0;
+    }
+
+    str_split_init(&split, source, delimiters, length, max - 1, options);
+    while (count < max && str_split_next(&split, &fields[count])) {
+        count++;
+    }
+
+    return count;
+}
+
+struct StrMatcherData
+{
+    char *bytes;
+    int64_t *offsets;
+    int64_t *lengths;
+    int *order;
+    bool teddy;
+    int teddy_bytes;
+    uint8_t teddy_low[STR_TEDDY_MAX_BYTES][16];
+    uint8_t teddy_high[STR_TEDDY_MAX_BYTES][16];
+    int classes;
+    uint16_t byte_class[256];
+    int32_t *transitions;
+    int32_t *outputs;
+    int32_t *dictionary;
+    int *next_output;
+};
+
+/**
+ * Collects the matches reported by the matcher engines.
+ */
+typedef struct StrMatchSink
+{
+    StrMatch *matches;
+    int64_t max;
+    int64_t count;
+    bool first_only;
+} StrMatchSink;
+
+/**
+ * Records a match. Returns false when the search must stop.
+ */
+static bool str_match_sink_add(StrMatchSink *sink, int64_t index, int64_t length, int pattern)
+{
+    if (sink->count < sink->max) {
+        sink->matches[sink->count].index = index;
+        sink->matches[sink->count].length = length;
+        sink->matches[sink->count].pattern = pattern;
+    }
+
+    sink->count++;
+    return !sink->first_only;
+}
+
+/**
+ * Verifies every pattern selected by the bucket mask against the given end position, longest first.
+ * Returns false when the search must stop.
+ */
+static bool str_teddy_verify(const StrMatcher *matcher, const char *s, int64_t end, unsigned buckets, StrMatchSink *sink)
+{
+    const struct StrMatcherData *data = matcher->data;
+
+    for (int i = 0; i < matcher->count; i++) {
+        int id = data->order[i];
+        int64_t length = data->lengths[id];
+        int64_t start = end - length + 1;
+
+        if ((buckets & (1u << id)) && start >= 0 && memcmp(s + start, data->bytes + data->offsets[id], length) == 0) {
+            if (!str_match_sink_add(sink, start, length, id)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+#ifdef STR_HAVE_X86_SIMD
+/**
+ * Teddy-style search: each pattern owns a bucket bit and the last bytes of the patterns are matched by nibble
+ * with pshufb lookups, producing the candidate end positions of 16 windows at a time.
+ */
+__attribute__((target("ssse3")))
+static void str_teddy_search(const StrMatcher *matcher, const char *s, int64_t length, StrMatchSink *sink)
+{
+    const struct StrMatcherData *data = matcher->data;
+    const int k = data->teddy_bytes;
+    const __m128i nibble = _mm_set1_epi8(0x0f);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i low[STR_TEDDY_MAX_BYTES];
+    __m128i high[STR_TEDDY_MAX_BYTES];
+    int64_t end = k - 1;
+
+    for (int t = 0; t < k; t++) {
+        low[t] = _mm_loadu_si128((const __m128i *) data->teddy_low[t]);
+        high[t] = _mm_loadu_si128((const __m128i *) data->teddy_high[t]);
+    }
+
+    for (; end + 16 <= length; end += 16) {
+        __m128i candidates = _mm_set1_epi8((char) 0xff);
+
+        for (int t = 0; t < k; t++) {
+            const __m128i block = _mm_loadu_si128((const __m128i *) (s + end - (k - 1) + t));
+            const __m128i lo = _mm_shuffle_epi8(low[t], _mm_and_si128(block, nibble));
+            const __m128i hi = _mm_shuffle_epi8(high[t], _mm_and_si128(_mm_srli_epi16(block, 4), nibble));
+            candidates = _mm_and_si128(candidates, _mm_and_si128(lo, hi));
+        }
+
+        unsigned mask = ~(unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(candidates, zero)) & 0xffff;
+        if (mask != 0) {
+            uint8_t buckets[16];
+            _mm_storeu_si128((__m128i *) buckets, candidates);
+
+            while (mask != 0) {
+                int offset = __builtin_ctz(mask);
+                if (!str_teddy_verify(matcher, s, end + offset, buckets[offset], sink)) {
+                    return;
+                }
+
+                mask &= mask - 1;
+            }
+        }
+    }
+
+    /* Verify the remaining positions directly */
+    for (; end < length; end++) {
+        if (!str_teddy_verify(matcher, s, end, 0xff, sink)) {
+            return;
+        }
+    }
+}
+#endif
+
+static void str_aho_corasick_search(const StrMatcher *matcher, const char *s, int64_t length, StrMatchSink *sink)
+{
+    const struct StrMatcherData *data = matcher->data;
+    const unsigned char *h = (const unsigned char *) s;
+    int32_t state = 0;
+
+    for (int64_t i = 0; i < length; i++) {
+        state = data->transitions[(int64_t) state * data->classes + data->byte_class[h[i]]];
+
+        /* Report the patterns of this state and of its dictionary suffixes, longest first */
+        for (int32_t t = data->outputs[state] >= 0 ? state : data->dictionary[state]; t > 0; t = data->dictionary[t]) {
+            for (int id = data->outputs[t]; id >= 0; id = data->next_output[id]) {
+                if (!str_match_sink_add(sink, i - data->lengths[id] + 1, data->lengths[id], id)) {
+                    return;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Builds the Aho-Corasick automaton as a dense DFA over the byte classes used by the patterns.
+ */
+static bool str_aho_corasick_build(const StrMatcher *matcher, int64_t total_length)
+{
+    struct StrMatcherData *data = matcher->data;
+    const int64_t max_states = total_length + 1;
+
+    data->classes = 1;
+    for (int64_t i = 0; i < total_length; i++) {
+        unsigned char c = (unsigned char) data->bytes[i];
+        if (data->byte_class[c] == 0) {
+            data->byte_class[c] = (uint16_t) data->classes++;
+        }
+    }
+
+    const int classes = data->classes;
+    data->transitions = malloc(sizeof(int32_t) * max_states * classes);
+    data->outputs = malloc(sizeof(int32_t) * max_states);
+    data->dictionary = calloc(max_states, sizeof(int32_t));
+    int32_t *fail = calloc(max_states, sizeof(int32_t));
+    int32_t *queue = malloc(sizeof(int32_t) * max_states);
+
+    if (!data->transitions || !data->outputs || !data->dictionary || !fail || !queue) {
+        free(fail);
+        free(queue);
+        return false;
+    }
+
+    for (int64_t i = 0; i < max_states * classes; i++) {
+        data->transitions[i] = -1;
+    }
+
+    for (int64_t i = 0; i < max_states; i++) {
+        data->outputs[i] = -1;
+    }
+
+    /* Build the trie. Patterns are inserted in reverse order so that output lists are sorted by id */
+    int32_t states = 1;
+    for (int id = matcher->count - 1; id >= 0; id--) {
+        const unsigned char *p = (const unsigned char *) data->bytes + data->offsets[id];
+        int32_t state = 0;
+
+        for (int64_t i = 0; i < data->lengths[id]; i++) {
+            int32_t *next = &data->transitions[(int64_t) state * classes + data->byte_class[p[i]]];
+            if (*next < 0) {
+                *next = states++;
+            }
+
+            state = *next;
+        }
+
+        data->next_output[id] = data->outputs[state];
+        data->outputs[state] = id;
+    }
+
+    /* Compute failure links breadth first and complete the transitions */
+    int32_t head = 0;
+    int32_t tail = 0;
+
+    for (int c = 0; c < classes; c++) {
+        int32_t *next = &data->transitions[c];
+        if (*next < 0) {
+            *next = 0;
+        } else {
+            queue[tail++] = *next;
+        }
+    }
+
+    while (head < tail) {
+        int32_t state = queue[head++];
+
+        for (int c = 0; c < classes; c++) {
+            int32_t *next = &data->transitions[(int64_t) state * classes + c];
+            int32_t fallback = data->transitions[(int64_t) fail[state] * classes + c];
+
+            if (*next < 0) {
+                *next = fallback;
+            } else {
+                fail[*next] = fallback;
+                data->dictionary[*next] = data->outputs[fallback] >= 0 ? fallback : data->dictionary[fallback];
+                queue[tail++] = *next;
+            }
+        }
+    }
+
+    free(fail);
+    free(queue);
+    return true;
+}
+
+/**
+ * Prepares the nibble masks used by str_teddy_search().
+ */
+static void str_teddy_build(const StrMatcher *matcher, int64_t min_length)
+{
+    struct StrMatcherData *data = matcher->data;
+    const int k = (int) MIN(min_length, STR_TEDDY_MAX_BYTES);
+
+    data->teddy_bytes = k;
+    for (int id = 0; id < matcher->count; id++) {
+        const unsigned char *p = (const unsigned char *) data->bytes + data->offsets[id] + data->lengths[id] - k;
+
+        for (int t = 0; t < k; t++) {
+            data->teddy_low[t][p[t] & 0x0f] |= (uint8_t) (1u << id);
+            data->teddy_high[t][p[t] >> 4] |= (uint8_t) (1u << id);
+        }
+    }
+}
+
+bool str_matcher_init(StrMatcher *matcher, const char *const *patterns, const int64_t *lengths, int count)
+{
+    if (count <= 0) {
+        return false;
+    }
+
+    struct StrMatcherData *data = calloc(1, sizeof(struct StrMatcherData));
+    if (data == NULL) {
+        return false;
+    }
+
+    matcher->data = data;
+    matcher->count = count;
+    data->offsets = malloc(sizeof(int64_t) * count);
+    data->lengths = malloc(sizeof(int64_t) * count);
+    data->order = malloc(sizeof(int) * count);
+    data->next_output = malloc(sizeof(int) * count);
+
+    if (!data->offsets || !data->lengths || !data->order || !data->next_output) {
+        str_matcher_finalize(matcher);
+        return false;
+    }
+
+    int64_t total_length = 0;
+    int64_t min_length = INT64_MAX;
+
+    for (int id = 0; id < count; id++) {
+        int64_t length = lengths && lengths[id] >= 0 ? lengths[id] : str_get_len(patterns[id]);
+        if (length == 0) {
+            str_matcher_finalize(matcher);
+            return false;
+        }
+
+        data->offsets[id] = total_length;
+        data->lengths[id] = length;
+        total_length += length;
+        min_length = MIN(min_length, length);
+    }
+
+    data->bytes = malloc(sizeof(char) * total_length);
+    if (data->bytes == NULL) {
+        str_matcher_finalize(matcher);
+        return false;
+    }
+
+    for (int id = 0; id < count; id++) {
+        memcpy(data->bytes + data->offsets[id], patterns[id], data->lengths[id]);
+    }
+
+    /* Order used to report matches ending at the same position: longest first, then by id */
+    for (int i = 0; i < count; i++) {
+        int id = i;
+        int j = i;
+
+        for (; j > 0 && data->lengths[data->order[j - 1]] < data->lengths[id]; j--) {
+            data->order[j] = data->order[j - 1];
+        }
+
+        data->order[j] = id;
+    }
+
+#ifdef STR_HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (count <= STR_TEDDY_MAX_PATTERNS && __builtin_cpu_supports("ssse3")) {
+        data->teddy = true;
+        str_teddy_build(matcher, min_length);
+        return true;
+    }
+#endif
+
+    if (!str_aho_corasick_build(matcher, total_length)) {
+        str_matcher_finalize(matcher);
+        return false;
+    }
+
+    return true;
+}
+
+void str_matcher_finalize(StrMatcher *matcher)
+{
+    if (matcher && matcher->data) {
+        struct StrMatcherData *data = matcher->data;
+
+        free(data->bytes);
+        free(data->offsets);
+        free(data->lengths);
+        free(data->order);
+        free(data->transitions);
+        free(data->outputs);
+        free(data->dictionary);
+        free(data->next_output);
+        free(data);
+
+        matcher->data = NULL;
+        matcher->count = 0;
+    }
+}
+
+/**
+ * Runs the engine of the matcher over the string.
+ */
+static void str_matcher_run(const StrMatcher *matcher, const char *s, int64_t length, StrMatchSink *sink)
+{
+#ifdef STR_HAVE_X86_SIMD
+    if (matcher->data->teddy) {
+        str_teddy_search(matcher, s, length, sink);
+        return;
+    }
+#endif
+
+    str_aho_corasick_search(matcher, s, length, sink);
+}
+
+bool str_matcher_find_str(const StrMatcher *matcher, const char *s, int64_t length, StrMatch *match)
+{
+    if (length < 0) {
+        length = str_get_len(s);
+    }
+
+    StrMatchSink sink = {match, match ? 1 : 0, 0, true};
+    str_matcher_run(matcher, s, length, &sink);
+    return sink.count > 0;
+}
+
+int64_t str_matcher_find_all_str(const StrMatcher *matcher, const char *s, int64_t length, StrMatch *matches, int64_t max)
+{
+    if (length < 0) {
+        length = str_get_len(s);
+    }
+
+    StrMatchSink sink = {matches, max, 0, false};
+    str_matcher_run(matcher, s, length, &sink);
+    return sink.count;
+}
+
+struct StrArenaChunk
+{
+    struct StrArenaChunk *next;
+    int64_t size;
+    int64_t used;
+};
+
+#define STR_ARENA_HEADER_SIZE STR_ALIGN((int64_t) sizeof(struct StrArenaChunk))
+#define STR_ARENA_CHUNK_DATA(chunk) ((char *) (chunk) + STR_ARENA_HEADER_SIZE)
+
+static void *str_arena_allocate(void *context, int64_t size)
+{
+    StrArena *arena = context;
+    struct StrArenaChunk *chunk = arena->current;
+    struct StrArenaChunk *previous = NULL;
+
+    size = STR_ALIGN(size);
+
+    /* Move forward through the chunks kept by str_arena_reset() until one fits */
+    while (chunk && chunk->used + size > chunk->size) {
+        previous = chunk;
+        chunk = chunk->next;
+
+        if (chunk) {
+            chunk->used = 0;
+        }
+    }
+
+    if (chunk == NULL) {
+        int64_t chunk_size = MAX(arena->chunk_size, size);
+
+        chunk = malloc(STR_ARENA_HEADER_SIZE + chunk_size);
+        if (chunk == NULL) {
+            return NULL;
+        }
+
+        chunk->next = NULL;
+        chunk->size = chunk_size;
+        chunk->used = 0;
+
+        if (previous) {
+            previous->next = chunk;
+        } else {
+            arena->first = chunk;
+        }
+    }
+
+    void *ptr = STR_ARENA_CHUNK_DATA(chunk) + chunk->used;
+    chunk->used += size;
+    arena->current = chunk;
+    arena->last = ptr;
+    return ptr;
+}
+
+static void *str_arena_reallocate(void *context, void *ptr, int64_t old_size, int64_t new_size)
+{
+    StrArena *arena = context;
+    struct StrArenaChunk *chunk = arena->current;
+
+    if (ptr && ptr == arena->last) {
+        /* The most recent allocation can grow or shrink in place */
+        int64_t offset = (char *) ptr - STR_ARENA_CHUNK_DATA(chunk);
+        if (offset + STR_ALIGN(new_size) <= chunk->size) {
+            chunk->used = offset + STR_ALIGN(new_size);
+            return ptr;
+        }
+    } else if (ptr && new_size <= old_size) {
+        return ptr;
+    }
+
+    void *mem = str_arena_allocate(arena, new_size);
+    if (mem && ptr) {
+        memcpy(mem, ptr, MIN(old_size, new_size));
+    }
+
+    return mem;
+}
+
+static void str_arena_release(void *context, void *ptr, int64_t size)
+{
+    StrArena *arena = context;
+    (void) size;
+
+    if (ptr && ptr == arena->last) {
+        /* Give back the most recent allocation */
+        arena->current->used = (char *) ptr - STR_ARENA_CHUNK_DATA(arena->current);
+        arena->last = NULL;
+    }
+}
+
+void str_arena_init(StrArena *arena, int64_t chunk_size)
+{
+    arena->allocator.allocate = str_arena_allocate;
+    arena->allocator.reallocate = str_arena_reallocate;
+    arena->allocator.release = str_arena_release;
+    arena->allocator.context = arena;
+    arena->first = NULL;
+    arena->current = NULL;
+    arena->last = NULL;
+    arena->chunk_size = chunk_size > 0 ? chunk_size : STR_ARENA_DEFAULT_CHUNK_SIZE;
+}
+
+void str_arena_reset(StrArena *arena)
+{
+    arena->current = arena->first;
+    arena->last = NULL;
+
+    if (arena->current) {
+        arena->current->used = 0;
+    }
+}
+
+void str_arena_finalize(StrArena *arena)
+{
+    if (arena) {
+        struct StrArenaChunk *chunk = arena->first;
+
+        while (chunk) {
+            struct StrArenaChunk *next = chunk->next;
+            free(chunk);
+            chunk = next;
+        }
+
+        arena->first = NULL;
+        arena->current = NULL;
+        arena->last = NULL;
+    }
+}
+
+#ifdef STR_HAVE_POSIX
+static void *str_mmap_allocate(void *context, int64_t size)
+{
+    (void) context;
+
+    void *ptr = mmap(NULL, (size_t) size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return ptr != MAP_FAILED ? ptr : NULL;
+}
+
+static void *str_mmap_reallocate(void *context, void *ptr, int64_t old_size, int64_t new_size)
+{
+#ifdef STR_HAVE_MREMAP
+    (void) context;
+
+    void *mem = mremap(ptr, (size_t) old_size, (size_t) new_size, MREMAP_MAYMOVE);
+    return mem != MAP_FAILED ? mem : NULL;
+#else
+    void *mem = str_mmap_allocate(context, new_size);
+
+    if (mem) {
+        memcpy(mem, ptr, MIN(old_size, new_size));
+        munmap(ptr, (size_t) old_size);
+    }
+
+    return mem;
+#endif
+}
+
+static void str_mmap_release(void *context, void *ptr, int64_t size)
+{
+    (void) context;
+    munmap(ptr, (size_t) size);
+}
+
+const StrAllocator str_mmap_allocator = {str_mmap_allocate, str_mmap_reallocate, str_mmap_release, NULL};
+#endif
+
+/**
+ * Returns the size class of a block, or -1 if the block is too large for the pool.
+ */
+static int str_pool_class(int64_t size)
+{
+    if (size > STR_POOL_MAX_BLOCK) {
+        return -1;
+    }
+
+    int index = 0;
+    while ((STR_POOL_MIN_BLOCK << index) < size) {
+        index++;
+    }
+
+    return index;
+}
+
+static void *str_pool_allocate(void *context, int64_t size)
+{
+    StrPoolAllocator *pool = context;
+    int index = str_pool_class(size);
+
+    if (index < 0) {
+        return malloc(size);
+    }
+
+    void *block = pool->free_lists[index];
+    if (block) {
+        /* Pop a recycled block; the next pointer is stored in the block itself */
+        memcpy(&pool->free_lists[index], block, sizeof(void *));
+        return block;
+    }
+
+    return str_arena_allocate(&pool->arena, STR_POOL_MIN_BLOCK << index);
+}
+
+static void str_pool_release(void *context, void *ptr, int64_t size)
+{
+    StrPoolAllocator *pool = context;
+    int index = str_pool_class(size);
+
+    if (ptr == NULL) {
+        return;
+    }
+
+    if (index < 0) {
+        free(ptr);
+    } else {
+        memcpy(ptr, &pool->free_lists[index], sizeof(void *));
+        pool->free_lists[index] = ptr;
+    }
+}
+
+static void *str_pool_reallocate(void *context, void *ptr, int64_t old_size, int64_t new_size)
+{
+    int old_index = str_pool_class(old_size);
+    int new_index = str_pool_class(new_size);
+
+    if (ptr == NULL) {
+        return str_pool_allocate(context, new_size);
+    }
+
+    if (old_index == new_index) {
+        /* Same class: the block is already large enough, or both blocks belong to malloc() */
+        return old_index < 0 ? realloc(ptr, new_size) : ptr;
+    }
+
+    void *mem = str_pool_allocate(context, new_size);
+    if (mem) {
+        memcpy(mem, ptr, MIN(old_size, new_size));
+        str_pool_release(context, ptr, old_size);
+    }
+
+    return mem;
+}
+
+void str_pool_allocator_init(StrPoolAllocator *pool)
+{
+    pool->allocator.allocate = str_pool_allocate;
+    pool->allocator.reallocate = str_pool_reallocate;
+    pool->allocator.release = str_pool_release;
+    pool->allocator.context = pool;
+    str_arena_init(&pool->arena, 0);
+
+    for (int i = 0; i < STR_POOL_CLASSES; i++) {
+        pool->free_lists[i] = NULL;
+    }
+}
+
+void str_pool_allocator_finalize(StrPoolAllocator *pool)
+{
+    if (pool) {
+        str_arena_finalize(&pool->arena);
+
+        for (int i = 0; i < STR_POOL_CLASSES; i++) {
+            pool->free_lists[i] = NULL;
+        }
+    }
+}
+
+typedef enum StrFormatKind
+{
+    STR_FORMAT_LITERAL,
+    STR_FORMAT_SIGNED,
+    STR_FORMAT_UNSIGNED,
+    STR_FORMAT_STRING,
+    STR_FORMAT_CHAR,
+    STR_FORMAT_FLOAT,
+    STR_FORMAT_GENERIC,
+} StrFormatKind;
+
+typedef enum StrFormatModifier
+{
+    STR_MODIFIER_NONE,
+    STR_MODIFIER_HH,
+    STR_MODIFIER_H,
+    STR_MODIFIER_L,
+    STR_MODIFIER_LL,
+    STR_MODIFIER_J,
+    STR_MODIFIER_Z,
+    STR_MODIFIER_T,
+    STR_MODIFIER_LONG_DOUBLE,
+} StrFormatModifier;
+
+struct StrFormatSegment
+{
+    StrFormatKind kind;
+    const char *text;
+    int64_t length;
+    char conversion;
+    StrFormatModifier modifier;
+    StrIntFormat int_format;
+    StrPadOptions pad;
+    int width;
+    int precision;
+    bool width_arg;
+    bool precision_arg;
+};
+
+/**
+ * Parses a conversion specification that starts right after the '%'. Returns the position after the
+ * specification, or NULL if it is not supported.
+ */
+static const char *str_format_parse_spec(const char *p, struct StrFormatSegment *segment)
+{
+    bool flags = false;
+    bool zero = false;
+
+    segment->width = 0;
+    segment->precision = -1;
+    segment->width_arg = false;
+    segment->precision_arg = false;
+    segment->modifier = STR_MODIFIER_NONE;
+
+    for (; *p && strchr("-+ #0", *p); p++) {
+        if (*p == '0') {
+            zero = true;
+        } else {
+            flags = true;
+        }
+    }
+
+    if (*p == '*') {
+        segment->width_arg = true;
+        p++;
+    } else {
+        for (; *p >= '0' && *p <= '9'; p++) {
+            segment->width = segment->width * 10 + (*p - '0');
+        }
+    }
+
+    if (*p == '.') {
+        p++;
+        segment->precision = 0;
+
+        if (*p == '*') {
+            segment->precision_arg = true;
+            p++;
+        } else {
+            for (; *p >= '0' && *p <= '9'; p++) {
+                segment->precision = segment->precision * 10 + (*p - '0');
+            }
+        }
+    }
+
+    switch (*p) {
+        case 'h':
+            segment->modifier = p[1] == 'h' ? STR_MODIFIER_HH : STR_MODIFIER_H;
+            p += p[1] == 'h' ? 2 : 1;
+            break;
+        case 'l':
+            segment->modifier = p[1] == 'l' ? STR_MODIFIER_LL : STR_MODIFIER_L;
+            p += p[1] == 'l' ? 2 : 1;
+            break;
+        case 'j':
+            segment->modifier = STR_MODIFIER_J;
+            p++;
+            break;
+        case 'z':
+            segment->modifier = STR_MODIFIER_Z;
+            p++;
+            break;
+        case 't':
+            segment->modifier = STR_MODIFIER_T;
+            p++;
+            break;
+        case 'L':
+            segment->modifier = STR_MODIFIER_LONG_DOUBLE;
+            p++;
+            break;
+        default:
+            break;
+    }
+
+    segment->conversion = *p;
+    segment->pad = zero ? STR_PAD_ZERO : STR_PAD_SPACE;
+
+    const bool plain = !flags && !segment->width_arg && !segment->precision_arg;
+    const bool plain_int = plain && segment->precision < 0;
+
+    switch (*p) {
+        case 'd':
+        case 'i':
+            segment->kind = plain_int ? STR_FORMAT_SIGNED : STR_FORMAT_GENERIC;
+            segment->int_format = STR_INT_DECIMAL;
+            break;
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+            segment->kind = plain_int ? STR_FORMAT_UNSIGNED : STR_FORMAT_GENERIC;
+            segment->int_format = *p == 'u' ? STR_INT_DECIMAL :
+                                  *p == 'x' ? STR_INT_HEX :
+                                  *p == 'X' ? STR_INT_HEX_UPPER : STR_INT_OCTAL;
+            break;
+        case 's':
+            segment->kind = plain && !zero && segment->width == 0 && segment->precision < 0 &&
+                            segment->modifier == STR_MODIFIER_NONE ? STR_FORMAT_STRING : STR_FORMAT_GENERIC;
+            break;
+        case 'c':
+            segment->kind = plain_int && !zero && segment->width == 0 &&
+                            segment->modifier == STR_MODIFIER_NONE ? STR_FORMAT_CHAR : STR_FORMAT_GENERIC;
+            break;
+        case 'f':
+            segment->kind = plain && !zero && segment->width == 0 &&
+                            segment->modifier == STR_MODIFIER_NONE ? STR_FORMAT_FLOAT : STR_FORMAT_GENERIC;
+            break;
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+        case 'p':
+            segment->kind = STR_FORMAT_GENERIC;
+            break;
+        default:
+            /* %n and unknown conversions are not supported */
+            return NULL;
+    }
+
+    return p + 1;
+}
+
+bool str_format_init(StrFormat *format, const char *pattern)
+{
+    const int64_t length = str_get_len(pattern);
+
+    /* Every segment consumes at least one character of the pattern */
+    format->segments = malloc(sizeof(struct StrFormatSegment) * (length + 1));
+    format->text = malloc(sizeof(char) * (length * 2 + 2));
+    format->count = 0;
+
+    if (!format->segments || !format->text) {
+        str_format_finalize(format);
+        return false;
+    }
+
+    /* Literals point to the pattern copied in the first half; generic specs are copied in the second half */
+    char *literals = format->text;
+    char *specs = format->text + length + 1;
+    const char *p = pattern;
+
+    /* The index of the last segment when it is a literal, to merge the literals split by "%%" */
+    int last_literal = -1;
+
+    memcpy(literals, pattern, length + 1);
+
+    while (*p) {
+        struct StrFormatSegment *segment = &format->segments[format->count];
+
+        if (*p != '%' || p[1] == '%') {
+            const char *start = p;
+            int64_t literal_length = 1;
+
+            if (*p == '%') {
+                /* "%%" is a literal '%' */
+                p += 2;
+            } else {
+                const char *next = strchr(p, '%');
+                p = next ? next : pattern + length;
+                literal_length = p - start;
+            }
+
+            const char *text = literals + (start - pattern);
+
+            if (last_literal >= 0 && format->segments[last_literal].text + format->segments[last_literal].length == text) {
+                format->segments[last_literal].length += literal_length;
+            } else {
+                segment->kind = STR_FORMAT_LITERAL;
+                segment->text = text;
+                segment->length = literal_length;
+                last_literal = format->count++;
+            }
+
+            continue;
+        }
+
+        const char *end = str_format_parse_spec(p + 1, segment);
+        if (end == NULL) {
+            str_format_finalize(format);
+            return false;
+        }
+
+        segment->length = end - p;
+        segment->text = specs;
+        memcpy(specs, p, segment->length);
+        specs[segment->length] = '\0';
+        specs += segment->length + 1;
+
+        format->count++;
+        last_literal = -1;
+        p = end;
+    }
+
+    return true;
+}
+
+void str_format_finalize(StrFormat *format)
+{
+    if (format) {
+        free(format->segments);
+        free(format->text);
+        format->segments = NULL;
+        format->text = NULL;
+        format->count = 0;
+    }
+}
+
+static int64_t str_format_signed_arg(StrFormatModifier modifier, va_list *args)
+{
+    switch (modifier) {
+        case STR_MODIFIER_HH:
+            return (signed char) va_arg(*args, int);
+        case STR_MODIFIER_H:
+            return (short) va_arg(*args, int);
+        case STR_MODIFIER_L:
+            return va_arg(*args, long);
+        case STR_MODIFIER_LL:
+            return va_arg(*args, long long);
+        case STR_MODIFIER_J:
+            return va_arg(*args, intmax_t);
+        case STR_MODIFIER_Z:
+            return (int64_t) va_arg(*args, size_t);
+        case STR_MODIFIER_T:
+            return va_arg(*args, ptrdiff_t);
+        default:
+            return va_arg(*args, int);
+    }
+}
+
+static uint64_t str_format_unsigned_arg(StrFormatModifier modifier, va_list *args)
+{
+    switch (modifier) {
+        case STR_MODIFIER_HH:
+            return (unsigned char) va_arg(*args, unsigned int);
+        case STR_MODIFIER_H:
+            return (unsigned short) va_arg(*args, unsigned int);
+        case STR_MODIFIER_L:
+            return va_arg(*args, unsigned long);
+        case STR_MODIFIER_LL:
+            return va_arg(*args, unsigned long long);
+        case STR_MODIFIER_J:
+            return va_arg(*args, uintmax_t);
+        case STR_MODIFIER_Z:
+            return va_arg(*args, size_t);
+        case STR_MODIFIER_T:
+            return (uint64_t) va_arg(*args, ptrdiff_t);
+        default:
+            return va_arg(*args, unsigned int);
+    }
+}
+
+/**
+ * Formats a single specification with vsnprintf(), forwarding the '*' arguments and the value.
+ */
+#define STR_FORMAT_GENERIC(type) \
+    do { \
+        type value = va_arg(*args, type); \
+        if (segment->width_arg && segment->precision_arg) { \
+            result = str_append_format(str, segment->text, width, precision, value); \
+        } else if (segment->width_arg) { \
+            result = str_append_format(str, segment->text, width, value); \
+        } else if (segment->precision_arg) { \
+            result = str_append_format(str, segment->text, precision, value); \
+        } else { \
+            result = str_append_format(str, segment->text, value); \
+        } \
+    } while (0)
+
+static bool str_format_generic(Str *str, const struct StrFormatSegment *segment, va_list *args)
+{
+    bool result;
+    int width = segment->width_arg ? va_arg(*args, int) : 0;
+    int precision = segment->precision_arg ? va_arg(*args, int) : 0;
+
+    switch (segment->conversion) {
+        case 'd':
+        case 'i':
+            switch (segment->modifier) {
+                case STR_MODIFIER_L:
+                    STR_FORMAT_GENERIC(long);
+                    break;
+                case STR_MODIFIER_LL:
+                    STR_FORMAT_GENERIC(long long);
+                    break;
+                case STR_MODIFIER_J:
+                    STR_FORMAT_GENERIC(intmax_t);
+                    break;
+                case STR_MODIFIER_Z:
+                    STR_FORMAT_GENERIC(size_t);
+                    break;
+                case STR_MODIFIER_T:
+                    STR_FORMAT_GENERIC(ptrdiff_t);
+                    break;
+                default:
+                    STR_FORMAT_GENERIC(int);
+                    break;
+            }
+            break;
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+            switch (segment->modifier) {
+                case STR_MODIFIER_L:
+                    STR_FORMAT_GENERIC(unsigned long);
+                    break;
+                case STR_MODIFIER_LL:
+                    STR_FORMAT_GENERIC(unsigned long long);
+                    break;
+                case STR_MODIFIER_J:
+                    STR_FORMAT_GENERIC(uintmax_t);
+                    break;
+                case STR_MODIFIER_Z:
+                    STR_FORMAT_GENERIC(size_t);
+                    break;
+                case STR_MODIFIER_T:
+                    STR_FORMAT_GENERIC(ptrdiff_t);
+                    break;
+                default:
+                    STR_FORMAT_GENERIC(unsigned int);
+                    break;
+            }
+            break;
+        case 'c':
+            STR_FORMAT_GENERIC(int);
+            break;
+        case 's':
+        case 'p':
+            STR_FORMAT_GENERIC(void *);
+            break;
+        default:
+            if (segment->modifier == STR_MODIFIER_LONG_DOUBLE) {
+                STR_FORMAT_GENERIC(long double);
+            } else {
+                STR_FORMAT_GENERIC(double);
+            }
+            break;
+    }
+
+    return result;
+}
+
+#undef STR_FORMAT_GENERIC
+
+bool str_append_format_compiled(Str *str, const StrFormat *format, ...)
+{
+    const int64_t length = str->length;
+    bool result = true;
+    va_list args;
+
+    if (!str_detach(str)) {
+        return false;
+    }
+
+    va_start(args, format);
+
+    for (int i = 0; i < format->count && result; i++) {
+        const struct StrFormatSegment *segment = &format->segments[i];
+
+        switch (segment->kind) {
+            case STR_FORMAT_LITERAL:
+                result = str_append_str(str, segment->text, segment->length);
+                break;
+            case STR_FORMAT_SIGNED: {
+                int64_t value = str_format_signed_arg(segment->modifier, &args);
+                uint64_t magnitude = value < 0 ? ~((uint64_t) value) + 1 : (uint64_t) value;
+                result = str_append_integer(str, magnitude, value < 0, STR_INT_DECIMAL, segment->width, segment->pad);
+                break;
+            }
+            case STR_FORMAT_UNSIGNED: {
+                uint64_t value = str_format_unsigned_arg(segment->modifier, &args);
+                result = str_append_integer(str, value, false, segment->int_format, segment->width, segment->pad);
+                break;
+            }
+            case STR_FORMAT_STRING:
+                result = str_append_str(str, va_arg(args, const char *), -1);
+                break;
+            case STR_FORMAT_CHAR:
+                result = str_append_char(str, (char) va_arg(args, int));
+                break;
+            case STR_FORMAT_FLOAT:
+                result = str_append_float(str, va_arg(args, double), segment->precision);
+                break;
+            default:
+                result = str_format_generic(str, segment, &args);
+                break;
+        }
+    }
+
+    va_end(args);
+
+    if (!result) {
+        /* Discard the partial output */
+        str->length = length;
+        str->value[length] = '\0';
+    }
+
+    return result;
+}
+
+#ifdef STR_LITTLE_ENDIAN
+/**
+ * Returns true if the 8 bytes loaded in v are all decimal digits.
+ */
+static bool str_is_eight_digits(uint64_t v)
+{
+    return ((v & 0xf0f0f0f0f0f0f0f0) | (((v + 0x0606060606060606) & 0xf0f0f0f0f0f0f0f0) >> 4)) == 0x3333333333333333;
+}
+
+/**
+ * Converts 8 decimal digits loaded in v to their value with three multiplications (SWAR).
+ */
+static uint32_t str_parse_eight_digits(uint64_t v)
+{
+    const uint64_t mask = 0x000000ff000000ff;
+    const uint64_t mul1 = 0x000f424000000064;
+    const uint64_t mul2 = 0x0000271000000001;
+
+    v -= 0x3030303030303030;
+    v = (v * 10) + (v >> 8);
+    v = (((v & mask) * mul1) + (((v >> 16) & mask) * mul2)) >> 32;
+    return (uint32_t) v;
+}
+#endif
+
+/**
+ * Parses a run of decimal digits. Returns the position after the digits; on overflow the digits are still
+ * consumed and the flag is set.
+ */
+static const char *str_parse_digits(const char *p, const char *e, uint64_t *value, bool *overflow)
+{
+    uint64_t v = 0;
+
+#ifdef STR_LITTLE_ENDIAN
+    /* 8 digits at a time while the result cannot overflow */
+    while (e - p >= 8 && v < 100000000000ULL) {
+        uint64_t chunk;
+        memcpy(&chunk, p, sizeof(chunk));
+
+        if (!str_is_eight_digits(chunk)) {
+            break;
+        }
+
+        v = v * 100000000 + str_parse_eight_digits(chunk);
+        p += 8;
+    }
+#endif
+
+    for (; p < e && *p >= '0' && *p <= '9'; p++) {
+        const unsigned d = (unsigned) (*p - '0');
+
+        if (v > (UINT64_MAX - d) / 10) {
+            *overflow = true;
+        } else {
+            v = v * 10 + d;
+        }
+    }
+
+    *value = v;
+    return p;
+}
+
+StrParseResult str_parse_uint_str(const char *s, int64_t length, uint64_t *value, int64_t *consumed)
+{
+    if (length < 0) {
+        length = str_get_len(s);
+    }
+
+    const char *e = s + length;
+    const char *p = s;
+    bool overflow = false;
+
+    if (p < e && *p == '+') {
+        p++;
+    }
+
+    const char *end = str_parse_digits(p, e, value, &overflow);
+    if (end == p) {
+        *value = 0;
+        if (consumed) {
+            *consumed = 0;
+        }
+
+        return STR_PARSE_INVALID;
+    }
+
+    if (consumed) {
+        *consumed = end - s;
+    }
+
+    if (overflow) {
+        *value = UINT64_MAX;
+        return STR_PARSE_OVERFLOW;
+    }
+
+    return STR_PARSE_OK;
+}
+
+StrParseResult str_parse_int_str(const char *s, int64_t length, int64_t *value, int64_t *consumed)
+{
+    if (length < 0) {
+        length = str_get_len(s);
+    }
+
+    const char *e = s + length;
+    const char *p = s;
+    const bool negative = p < e && *p == '-';
+    bool overflow = false;
+    uint64_t magnitude;
+
+    if (p < e && (*p == '-' || *p == '+')) {
+        p++;
+    }
+
+    const char *end = str_parse_digits(p, e, &magnitude, &overflow);
+    if (end == p) {
+        *value = 0;
+        if (consumed) {
+            *consumed = 0;
+        }
+
+        return STR_PARSE_INVALID;
+    }
+
+    if (consumed) {
+        *consumed = end - s;
+    }
+
+    if (overflow || magnitude > (uint64_t) INT64_MAX + negative) {
+        *value = negative ? INT64_MIN : INT64_MAX;
+        return STR_PARSE_OVERFLOW;
+    }
+
+    *value = negative ? (int64_t) (~magnitude + 1) : (int64_t) magnitude;
+    return STR_PARSE_OK;
+}
+
+/**
+ * Case-insensitive comparison of a prefix of the range with a lowercase ASCII word.
+ */
+static bool str_match_word(const char *p, const char *e, const char *word, int64_t length)
+{
+    if (e - p < length) {
+        return false;
+    }
+
+    for (int64_t i = 0; i < length; i++) {
+        if ((p[i] | 0x20) != word[i]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Multiplies two 64-bit integers and returns the low half of the 128-bit product. The high half is stored in high.
+ */
+static inline uint64_t str_mul128(uint64_t a, uint64_t b, uint64_t *high)
+{
+#ifdef __SIZEOF_INT128__
+    const unsigned __int128 r = (unsigned __int128) a * b;
+    *high = (uint64_t) (r >> 64);
+    return (uint64_t) r;
+#else
+    const uint64_t ha = a >> 32, hb = b >> 32, la = (uint32_t) a, lb = (uint32_t) b;
+    const uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    const uint64_t t = rl + (rm0 << 32);
+    const uint64_t lo = t + (rm1 << 32);
+    *high = rh + (rm0 >> 32) + (rm1 >> 32) + (t < rl) + (lo < t);
+    return lo;
+#endif
+}
+
+/**
+ * Returns the number of leading zero bits of a non-zero integer.
+ */
+static inline int str_leading_zeros64(uint64_t v)
+{
+#ifdef __GNUC__
+    return __builtin_clzll(v);
+#else
+    int n = 0;
+
+    for (; (v & ((uint64_t) 1 << 63)) == 0; v <<= 1) {
+        n++;
+    }
+
+    return n;
+#endif
+}
+
+#define STR_POWER_OF_FIVE_MIN (-342)
+#define STR_POWER_OF_FIVE_MAX 308
+
+/**
+ * The powers of five from 5^-342 to 5^308 as 128-bit values, high word first, shifted so the top bit is set.
+ * Positive powers are truncated and negative powers rounded up, as required by the Eisel-Lemire algorithm.
+ */
+static const uint64_t str_power_of_five_128[2 * (STR_POWER_OF_FIVE_MAX - STR_POWER_OF_FIVE_MIN + 1)] = {
+    0xeef453d6923bd65a, 0x113faa2906a13b3f, 0x9558b4661b6565f8, 0x4ac7ca59a424c507,
+    0xbaaee17fa23ebf76, 0x5d79bcf00d2df649, 0xe95a99df8ace6f53, 0xf4d82c2c107973dc,
+    0x91d8a02bb6c10594, 0x79071b9b8a4be869, 0xb64ec836a47146f9, 0x9748e2826cdee284,
+    0xe3e27a444d8d98b7, 0xfd1b1b2308169b25, 0x8e6d8c6ab0787f72, 0xfe30f0f5e50e20f7,
+    0xb208ef855c969f4f, 0xbdbd2d335e51a935, 0xde8b2b66b3bc4723, 0xad2c788035e61382,
+    0x8b16fb203055ac76, 0x4c3bcb5021afcc31, 0xaddcb9e83c6b1793, 0xdf4abe242a1bbf3d,
+    0xd953e8624b85dd78, 0xd71d6dad34a2af0d, 0x87d4713d6f33aa6b, 0x8672648c40e5ad68,
+    0xa9c98d8ccb009506, 0x680efdaf511f18c2, 0xd43bf0effdc0ba48, 0x0212bd1b2566def2,
+    0x84a57695fe98746d, 0x014bb630f7604b57, 0xa5ced43b7e3e9188, 0x419ea3bd35385e2d,
+    0xcf42894a5dce35ea, 0x52064cac828675b9, 0x818995ce7aa0e1b2, 0x7343efebd1940993,
+    0xa1ebfb4219491a1f, 0x1014ebe6c5f90bf8, 0xca66fa129f9b60a6, 0xd41a26e077774ef6,
+    0xfd00b897478238d0, 0x8920b098955522b4, 0x9e20735e8cb16382, 0x55b46e5f5d5535b0,
+    0xc5a890362fddbc62, 0xeb2189f734aa831d, 0xf712b443bbd52b7b, 0xa5e9ec7501d523e4,
+    0x9a6bb0aa55653b2d, 0x47b233c92125366e, 0xc1069cd4eabe89f8, 0x999ec0bb696e840a,
+    0xf148440a256e2c76, 0xc00670ea43ca250d, 0x96cd2a865764dbca, 0x380406926a5e5728,
+    0xbc807527ed3e12bc, 0xc605083704f5ecf2, 0xeba09271e88d976b, 0xf7864a44c633682e,
+    0x93445b8731587ea3, 0x7ab3ee6afbe0211d, 0xb8157268fdae9e4c, 0x5960ea05bad82964,
+    0xe61acf033d1a45df, 0x6fb92487298e33bd, 0x8fd0c16206306bab, 0xa5d3b6d479f8e056,
+    0xb3c4f1ba87bc8696, 0x8f48a4899877186c, 0xe0b62e2929aba83c, 0x331acdabfe94de87,
+    0x8c71dcd9ba0b4925, 0x9ff0c08b7f1d0b14, 0xaf8e5410288e1b6f, 0x07ecf0ae5ee44dd9,
+    0xdb71e91432b1a24a, 0xc9e82cd9f69d6150, 0x892731ac9faf056e, 0xbe311c083a225cd2,
+    0xab70fe17c79ac6ca, 0x6dbd630a48aaf406, 0xd64d3d9db981787d, 0x092cbbccdad5b108,
+    0x85f0468293f0eb4e, 0x25bbf56008c58ea5, 0xa76c582338ed2621, 0xaf2af2b80af6f24e,
+    0xd1476e2c07286faa, 0x1af5af660db4aee1, 0x82cca4db847945ca, 0x50d98d9fc890ed4d,
+    0xa37fce126597973c, 0xe50ff107bab528a0, 0xcc5fc196fefd7d0c, 0x1e53ed49a96272c8,
+    0xff77b1fcbebcdc4f, 0x25e8e89c13bb0f7a, 0x9faacf3df73609b1, 0x77b191618c54e9ac,
+    0xc795830d75038c1d, 0xd59df5b9ef6a2417, 0xf97ae3d0d2446f25, 0x4b0573286b44ad1d,
+    0x9becce62836ac577, 0x4ee367f9430aec32, 0xc2e801fb244576d5, 0x229c41f793cda73f,
+    0xf3a20279ed56d48a, 0x6b43527578c1110f, 0x9845418c345644d6, 0x830a13896b78aaa9,
+    0xbe5691ef416bd60c, 0x23cc986bc656d553, 0xedec366b11c6cb8f, 0x2cbfbe86b7ec8aa8,
+    0x94b3a202eb1c3f39, 0x7bf7d71432f3d6a9, 0xb9e08a83a5e34f07, 0xdaf5ccd93fb0cc53,
+    0xe858ad248f5c22c9, 0xd1b3400f8f9cff68, 0x91376c36d99995be, 0x23100809b9c21fa1,
+    0xb58547448ffffb2d, 0xabd40a0c2832a78a, 0xe2e69915b3fff9f9, 0x16c90c8f323f516c,
+    0x8dd01fad907ffc3b, 0xae3da7d97f6792e3, 0xb1442798f49ffb4a, 0x99cd11cfdf41779c,
+    0xdd95317f31c7fa1d, 0x40405643d711d583, 0x8a7d3eef7f1cfc52, 0x482835ea666b2572,
+    0xad1c8eab5ee43b66, 0xda3243650005eecf, 0xd863b256369d4a40, 0x90bed43e40076a82,
+    0x873e4f75e2224e68, 0x5a7744a6e804a291, 0xa90de3535aaae202, 0x711515d0a205cb36,
+    0xd3515c2831559a83, 0x0d5a5b44ca873e03, 0x8412d9991ed58091, 0xe858790afe9486c2,
+    0xa5178fff668ae0b6, 0x626e974dbe39a872, 0xce5d73ff402d98e3, 0xfb0a3d212dc8128f,
+    0x80fa687f881c7f8e, 0x7ce66634bc9d0b99, 0xa139029f6a239f72, 0x1c1fffc1ebc44e80,
+    0xc987434744ac874e, 0xa327ffb266b56220, 0xfbe9141915d7a922, 0x4bf1ff9f0062baa8,
+    0x9d71ac8fada6c9b5, 0x6f773fc3603db4a9, 0xc4ce17b399107c22, 0xcb550fb4384d21d3,
+    0xf6019da07f549b2b, 0x7e2a53a146606a48, 0x99c102844f94e0fb, 0x2eda7444cbfc426d,
+    0xc0314325637a1939, 0xfa911155fefb5308, 0xf03d93eebc589f88, 0x793555ab7eba27ca,
+    0x96267c7535b763b5, 0x4bc1558b2f3458de, 0xbbb01b9283253ca2, 0x9eb1aaedfb016f16,
+    0xea9c227723ee8bcb, 0x465e15a979c1cadc, 0x92a1958a7675175f, 0x0bfacd89ec191ec9,
+    0xb749faed14125d36, 0xcef980ec671f667b, 0xe51c79a85916f484, 0x82b7e12780e7401a,
+    0x8f31cc0937ae58d2, 0xd1b2ecb8b0908810, 0xb2fe3f0b8599ef07, 0x861fa7e6dcb4aa15,
+    0xdfbdcece67006ac9, 0x67a791e093e1d49a, 0x8bd6a141006042bd, 0xe0c8bb2c5c6d24e0,
+    0xaecc49914078536d, 0x58fae9f773886e18, 0xda7f5bf590966848, 0xaf39a475506a899e,
+    0x888f99797a5e012d, 0x6d8406c952429603, 0xaab37fd7d8f58178, 0xc8e5087ba6d33b83,
+    0xd5605fcdcf32e1d6, 0xfb1e4a9a90880a64, 0x855c3be0a17fcd26, 0x5cf2eea09a55067f,
+    0xa6b34ad8c9dfc06f, 0xf42faa48c0ea481e, 0xd0601d8efc57b08b, 0xf13b94daf124da26,
+    0x823c12795db6ce57, 0x76c53d08d6b70858, 0xa2cb1717b52481ed, 0x54768c4b0c64ca6e,
+    0xcb7ddcdda26da268, 0xa9942f5dcf7dfd09, 0xfe5d54150b090b02, 0xd3f93b35435d7c4c,
+    0x9efa548d26e5a6e1, 0xc47bc5014a1a6daf, 0xc6b8e9b0709f109a, 0x359ab6419ca1091b,
+    0xf867241c8cc6d4c0, 0xc30163d203c94b62, 0x9b407691d7fc44f8, 0x79e0de63425dcf1d,
+    0xc21094364dfb5636, 0x985915fc12f542e4, 0xf294b943e17a2bc4, 0x3e6f5b7b17b2939d,
+    0x979cf3ca6cec5b5a, 0xa705992ceecf9c42, 0xbd8430bd08277231, 0x50c6ff782a838353,
+    0xece53cec4a314ebd, 0xa4f8bf5635246428, 0x940f4613ae5ed136, 0x871b7795e136be99,
+    0xb913179899f68584, 0x28e2557b59846e3f, 0xe757dd7ec07426e5, 0x331aeada2fe589cf,
+    0x9096ea6f3848984f, 0x3ff0d2c85def7621, 0xb4bca50b065abe63, 0x0fed077a756b53a9,
+    0xe1ebce4dc7f16dfb, 0xd3e8495912c62894, 0x8d3360f09cf6e4bd, 0x64712dd7abbbd95c,
+    0xb080392cc4349dec, 0xbd8d794d96aacfb3, 0xdca04777f541c567, 0xecf0d7a0fc5583a0,
+    0x89e42caaf9491b60, 0xf41686c49db57244, 0xac5d37d5b79b6239, 0x311c2875c522ced5,
+    0xd77485cb25823ac7, 0x7d633293366b828b, 0x86a8d39ef77164bc, 0xae5dff9c02033197,
+    0xa8530886b54dbdeb, 0xd9f57f830283fdfc, 0xd267caa862a12d66, 0xd072df63c324fd7b,
+    0x8380dea93da4bc60, 0x4247cb9e59f71e6d, 0xa46116538d0deb78, 0x52d9be85f074e608,
+    0xcd795be870516656, 0x67902e276c921f8b, 0x806bd9714632dff6, 0x00ba1cd8a3db53b6,
+    0xa086cfcd97bf97f3, 0x80e8a40eccd228a4, 0xc8a883c0fdaf7df0, 0x6122cd128006b2cd,
+    0xfad2a4b13d1b5d6c, 0x796b805720085f81, 0x9cc3a6eec6311a63, 0xcbe3303674053bb0,
+    0xc3f490aa77bd60fc, 0xbedbfc4411068a9c, 0xf4f1b4d515acb93b, 0xee92fb5515482d44,
+    0x991711052d8bf3c5, 0x751bdd152d4d1c4a, 0xbf5cd54678eef0b6, 0xd262d45a78a0635d,
+    0xef340a98172aace4, 0x86fb897116c87c34, 0x9580869f0e7aac0e, 0xd45d35e6ae3d4da0,
+    0xbae0a846d2195712, 0x8974836059cca109, 0xe998d258869facd7, 0x2bd1a438703fc94b,
+    0x91ff83775423cc06, 0x7b6306a34627ddcf, 0xb67f6455292cbf08, 0x1a3bc84c17b1d542,
+    0xe41f3d6a7377eeca, 0x20caba5f1d9e4a93, 0x8e938662882af53e, 0x547eb47b7282ee9c,
+    0xb23867fb2a35b28d, 0xe99e619a4f23aa43, 0xdec681f9f4c31f31, 0x6405fa00e2ec94d4,
+    0x8b3c113c38f9f37e, 0xde83bc408dd3dd04, 0xae0b158b4738705e, 0x9624ab50b148d445,
+    0xd98ddaee19068c76, 0x3badd624dd9b0957, 0x87f8a8d4cfa417c9, 0xe54ca5d70a80e5d6,
+    0xa9f6d30a038d1dbc, 0x5e9fcf4ccd211f4c, 0xd47487cc8470652b, 0x7647c3200069671f,
+    0x84c8d4dfd2c63f3b, 0x29ecd9f40041e073, 0xa5fb0a17c777cf09, 0xf468107100525890,
+    0xcf79cc9db955c2cc, 0x7182148d4066eeb4, 0x81ac1fe293d599bf, 0xc6f14cd848405530,
+    0xa21727db38cb002f, 0xb8ada00e5a506a7c, 0xca9cf1d206fdc03b, 0xa6d90811f0e4851c,
+    0xfd442e4688bd304a, 0x908f4a166d1da663, 0x9e4a9cec15763e2e, 0x9a598e4e043287fe,
+    0xc5dd44271ad3cdba, 0x40eff1e1853f29fd, 0xf7549530e188c128, 0xd12bee59e68ef47c,
+    0x9a94dd3e8cf578b9, 0x82bb74f8301958ce, 0xc13a148e3032d6e7, 0xe36a52363c1faf01,
+    0xf18899b1bc3f8ca1, 0xdc44e6c3cb279ac1, 0x96f5600f15a7b7e5, 0x29ab103a5ef8c0b9,
+    0xbcb2b812db11a5de, 0x7415d448f6b6f0e7, 0xebdf661791d60f56, 0x111b495b3464ad21,
+    0x936b9fcebb25c995, 0xcab10dd900beec34, 0xb84687c269ef3bfb, 0x3d5d514f40eea742,
+    0xe65829b3046b0afa, 0x0cb4a5a3112a5112, 0x8ff71a0fe2c2e6dc, 0x47f0e785eaba72ab,
+    0xb3f4e093db73a093, 0x59ed216765690f56, 0xe0f218b8d25088b8, 0x306869c13ec3532c,
+    0x8c974f7383725573, 0x1e414218c73a13fb, 0xafbd2350644eeacf, 0xe5d1929ef90898fa,
+    0xdbac6c247d62a583, 0xdf45f746b74abf39, 0x894bc396ce5da772, 0x6b8bba8c328eb783,
+    0xab9eb47c81f5114f, 0x066ea92f3f326564, 0xd686619ba27255a2, 0xc80a537b0efefebd,
+    0x8613fd0145877585, 0xbd06742ce95f5f36, 0xa798fc4196e952e7, 0x2c48113823b73704,
+    0xd17f3b51fca3a7a0, 0xf75a15862ca504c5, 0x82ef85133de648c4, 0x9a984d73dbe722fb,
+    0xa3ab66580d5fdaf5, 0xc13e60d0d2e0ebba, 0xcc963fee10b7d1b3, 0x318df905079926a8,
+    0xffbbcfe994e5c61f, 0xfdf17746497f7052, 0x9fd561f1fd0f9bd3, 0xfeb6ea8bedefa633,
+    0xc7caba6e7c5382c8, 0xfe64a52ee96b8fc0, 0xf9bd690a1b68637b, 0x3dfdce7aa3c673b0,
+    0x9c1661a651213e2d, 0x06bea10ca65c084e, 0xc31bfa0fe5698db8, 0x486e494fcff30a62,
+    0xf3e2f893dec3f126, 0x5a89dba3c3efccfa, 0x986ddb5c6b3a76b7, 0xf89629465a75e01c,
+    0xbe89523386091465, 0xf6bbb397f1135823, 0xee2ba6c0678b597f, 0x746aa07ded582e2c,
+    0x94db483840b717ef, 0xa8c2a44eb4571cdc, 0xba121a4650e4ddeb, 0x92f34d62616ce413,
+    0xe896a0d7e51e1566, 0x77b020baf9c81d17, 0x915e2486ef32cd60, 0x0ace1474dc1d122e,
+    0xb5b5ada8aaff80b8, 0x0d819992132456ba, 0xe3231912d5bf60e6, 0x10e1fff697ed6c69,
+    0x8df5efabc5979c8f, 0xca8d3ffa1ef463c1, 0xb1736b96b6fd83b3, 0xbd308ff8a6b17cb2,
+    0xddd0467c64bce4a0, 0xac7cb3f6d05ddbde, 0x8aa22c0dbef60ee4, 0x6bcdf07a423aa96b,
+    0xad4ab7112eb3929d, 0x86c16c98d2c953c6, 0xd89d64d57a607744, 0xe871c7bf077ba8b7,
+    0x87625f056c7c4a8b, 0x11471cd764ad4972, 0xa93af6c6c79b5d2d, 0xd598e40d3dd89bcf,
+    0xd389b47879823479, 0x4aff1d108d4ec2c3, 0x843610cb4bf160cb, 0xcedf722a585139ba,
+    0xa54394fe1eedb8fe, 0xc2974eb4ee658828, 0xce947a3da6a9273e, 0x733d226229feea32,
+    0x811ccc668829b887, 0x0806357d5a3f525f, 0xa163ff802a3426a8, 0xca07c2dcb0cf26f7,
+    0xc9bcff6034c13052, 0xfc89b393dd02f0b5, 0xfc2c3f3841f17c67, 0xbbac2078d443ace2,
+    0x9d9ba7832936edc0, 0xd54b944b84aa4c0d, 0xc5029163f384a931, 0x0a9e795e65d4df11,
+    0xf64335bcf065d37d, 0x4d4617b5ff4a16d5, 0x99ea0196163fa42e, 0x504bced1bf8e4e45,
+    0xc06481fb9bcf8d39, 0xe45ec2862f71e1d6, 0xf07da27a82c37088, 0x5d767327bb4e5a4c,
+    0x964e858c91ba2655, 0x3a6a07f8d510f86f, 0xbbe226efb628afea, 0x890489f70a55368b,
+    0xeadab0aba3b2dbe5, 0x2b45ac74ccea842e, 0x92c8ae6b464fc96f, 0x3b0b8bc90012929d,
+    0xb77ada0617e3bbcb, 0x09ce6ebb40173744, 0xe55990879ddcaabd, 0xcc420a6a101d0515,
+    0x8f57fa54c2a9eab6, 0x9fa946824a12232d, 0xb32df8e9f3546564, 0x47939822dc96abf9,
+    0xdff9772470297ebd, 0x59787e2b93bc56f7, 0x8bfbea76c619ef36, 0x57eb4edb3c55b65a,
+    0xaefae51477a06b03, 0xede622920b6b23f1, 0xdab99e59958885c4, 0xe95fab368e45eced,
+    0x88b402f7fd75539b, 0x11dbcb0218ebb414, 0xaae103b5fcd2a881, 0xd652bdc29f26a119,
+    0xd59944a37c0752a2, 0x4be76d3346f0495f, 0x857fcae62d8493a5, 0x6f70a4400c562ddb,
+    0xa6dfbd9fb8e5b88e, 0xcb4ccd500f6bb952, 0xd097ad07a71f26b2, 0x7e2000a41346a7a7,
+    0x825ecc24c873782f, 0x8ed400668c0c28c8, 0xa2f67f2dfa90563b, 0x728900802f0f32fa,
+    0xcbb41ef979346bca, 0x4f2b40a03ad2ffb9, 0xfea126b7d78186bc, 0xe2f610c84987bfa8,
+    0x9f24b832e6b0f436, 0x0dd9ca7d2df4d7c9, 0xc6ede63fa05d3143, 0x91503d1c79720dbb,
+    0xf8a95fcf88747d94, 0x75a44c6397ce912a, 0x9b69dbe1b548ce7c, 0xc986afbe3ee11aba,
+    0xc24452da229b021b, 0xfbe85badce996168, 0xf2d56790ab41c2a2, 0xfae27299423fb9c3,
+    0x97c560ba6b0919a5, 0xdccd879fc967d41a, 0xbdb6b8e905cb600f, 0x5400e987bbc1c920,
+    0xed246723473e3813, 0x290123e9aab23b68, 0x9436c0760c86e30b, 0xf9a0b6720aaf6521,
+    0xb94470938fa89bce, 0xf808e40e8d5b3e69, 0xe7958cb87392c2c2, 0xb60b1d1230b20e04,
+    0x90bd77f3483bb9b9, 0xb1c6f22b5e6f48c2, 0xb4ecd5f01a4aa828, 0x1e38aeb6360b1af3,
+    0xe2280b6c20dd5232, 0x25c6da63c38de1b0, 0x8d590723948a535f, 0x579c487e5a38ad0e,
+    0xb0af48ec79ace837, 0x2d835a9df0c6d851, 0xdcdb1b2798182244, 0xf8e431456cf88e65,
+    0x8a08f0f8bf0f156b, 0x1b8e9ecb641b58ff, 0xac8b2d36eed2dac5, 0xe272467e3d222f3f,
+    0xd7adf884aa879177, 0x5b0ed81dcc6abb0f, 0x86ccbb52ea94baea, 0x98e947129fc2b4e9,
+    0xa87fea27a539e9a5, 0x3f2398d747b36224, 0xd29fe4b18e88640e, 0x8eec7f0d19a03aad,
+    0x83a3eeeef9153e89, 0x1953cf68300424ac, 0xa48ceaaab75a8e2b, 0x5fa8c3423c052dd7,
+    0xcdb02555653131b6, 0x3792f412cb06794d, 0x808e17555f3ebf11, 0xe2bbd88bbee40bd0,
+    0xa0b19d2ab70e6ed6, 0x5b6aceaeae9d0ec4, 0xc8de047564d20a8b, 0xf245825a5a445275,
+    0xfb158592be068d2e, 0xeed6e2f0f0d56712, 0x9ced737bb6c4183d, 0x55464dd69685606b,
+    0xc428d05aa4751e4c, 0xaa97e14c3c26b886, 0xf53304714d9265df, 0xd53dd99f4b3066a8,
+    0x993fe2c6d07b7fab, 0xe546a8038efe4029, 0xbf8fdb78849a5f96, 0xde98520472bdd033,
+    0xef73d256a5c0f77c, 0x963e66858f6d4440, 0x95a8637627989aad, 0xdde7001379a44aa8,
+    0xbb127c53b17ec159, 0x5560c018580d5d52, 0xe9d71b689dde71af, 0xaab8f01e6e10b4a6,
+    0x9226712162ab070d, 0xcab3961304ca70e8, 0xb6b00d69bb55c8d1, 0x3d607b97c5fd0d22,
+    0xe45c10c42a2b3b05, 0x8cb89a7db77c506a, 0x8eb98a7a9a5b04e3, 0x77f3608e92adb242,
+    0xb267ed1940f1c61c, 0x55f038b237591ed3, 0xdf01e85f912e37a3, 0x6b6c46dec52f6688,
+    0x8b61313bbabce2c6, 0x2323ac4b3b3da015, 0xae397d8aa96c1b77, 0xabec975e0a0d081a,
+    0xd9c7dced53c72255, 0x96e7bd358c904a21, 0x881cea14545c7575, 0x7e50d64177da2e54,
+    0xaa242499697392d2, 0xdde50bd1d5d0b9e9, 0xd4ad2dbfc3d07787, 0x955e4ec64b44e864,
+    0x84ec3c97da624ab4, 0xbd5af13bef0b113e, 0xa6274bbdd0fadd61, 0xecb1ad8aeacdd58e,
+    0xcfb11ead453994ba, 0x67de18eda5814af2, 0x81ceb32c4b43fcf4, 0x80eacf948770ced7,
+    0xa2425ff75e14fc31, 0xa1258379a94d028d, 0xcad2f7f5359a3b3e, 0x096ee45813a04330,
+    0xfd87b5f28300ca0d, 0x8bca9d6e188853fc, 0x9e74d1b791e07e48, 0x775ea264cf55347e,
+    0xc612062576589dda, 0x95364afe032a819e, 0xf79687aed3eec551, 0x3a83ddbd83f52205,
+    0x9abe14cd44753b52, 0xc4926a9672793543, 0xc16d9a0095928a27, 0x75b7053c0f178294,
+    0xf1c90080baf72cb1, 0x5324c68b12dd6339, 0x971da05074da7bee, 0xd3f6fc16ebca5e04,
+    0xbce5086492111aea, 0x88f4bb1ca6bcf585, 0xec1e4a7db69561a5, 0x2b31e9e3d06c32e6,
+    0x9392ee8e921d5d07, 0x3aff322e62439fd0, 0xb877aa3236a4b449, 0x09befeb9fad487c3,
+    0xe69594bec44de15b, 0x4c2ebe687989a9b4, 0x901d7cf73ab0acd9, 0x0f9d37014bf60a11,
+    0xb424dc35095cd80f, 0x538484c19ef38c95, 0xe12e13424bb40e13, 0x2865a5f206b06fba,
+    0x8cbccc096f5088cb, 0xf93f87b7442e45d4, 0xafebff0bcb24aafe, 0xf78f69a51539d749,
+    0xdbe6fecebdedd5be, 0xb573440e5a884d1c, 0x89705f4136b4a597, 0x31680a88f8953031,
+    0xabcc77118461cefc, 0xfdc20d2b36ba7c3e, 0xd6bf94d5e57a42bc, 0x3d32907604691b4d,
+    0x8637bd05af6c69b5, 0xa63f9a49c2c1b110, 0xa7c5ac471b478423, 0x0fcf80dc33721d54,
+    0xd1b71758e219652b, 0xd3c36113404ea4a9, 0x83126e978d4fdf3b, 0x645a1cac083126ea,
+    0xa3d70a3d70a3d70a, 0x3d70a3d70a3d70a4, 0xcccccccccccccccc, 0xcccccccccccccccd,
+    0x8000000000000000, 0x0000000000000000, 0xa000000000000000, 0x0000000000000000,
+    0xc800000000000000, 0x0000000000000000, 0xfa00000000000000, 0x0000000000000000,
+    0x9c40000000000000, 0x0000000000000000, 0xc350000000000000, 0x0000000000000000,
+    0xf424000000000000, 0x0000000000000000, 0x9896800000000000, 0x0000000000000000,
+    0xbebc200000000000, 0x0000000000000000, 0xee6b280000000000, 0x0000000000000000,
+    0x9502f90000000000, 0x0000000000000000, 0xba43b74000000000, 0x0000000000000000,
+    0xe8d4a51000000000, 0x0000000000000000, 0x9184e72a00000000, 0x0000000000000000,
+    0xb5e620f480000000, 0x0000000000000000, 0xe35fa931a0000000, 0x0000000000000000,
+    0x8e1bc9bf04000000, 0x0000000000000000, 0xb1a2bc2ec5000000, 0x0000000000000000,
+    0xde0b6b3a76400000, 0x0000000000000000, 0x8ac7230489e80000, 0x0000000000000000,
+    0xad78ebc5ac620000, 0x0000000000000000, 0xd8d726b7177a8000, 0x0000000000000000,
+    0x878678326eac9000, 0x0000000000000000, 0xa968163f0a57b400, 0x0000000000000000,
+    0xd3c21bcecceda100, 0x0000000000000000, 0x84595161401484a0, 0x0000000000000000,
+    0xa56fa5b99019a5c8, 0x0000000000000000, 0xcecb8f27f4200f3a, 0x0000000000000000,
+    0x813f3978f8940984, 0x4000000000000000, 0xa18f07d736b90be5, 0x5000000000000000,
+    0xc9f2c9cd04674ede, 0xa400000000000000, 0xfc6f7c4045812296, 0x4d00000000000000,
+    0x9dc5ada82b70b59d, 0xf020000000000000, 0xc5371912364ce305, 0x6c28000000000000,
+    0xf684df56c3e01bc6, 0xc732000000000000, 0x9a130b963a6c115c, 0x3c7f400000000000,
+    0xc097ce7bc90715b3, 0x4b9f100000000000, 0xf0bdc21abb48db20, 0x1e86d40000000000,
+    0x96769950b50d88f4, 0x1314448000000000, 0xbc143fa4e250eb31, 0x17d955a000000000,
+    0xeb194f8e1ae525fd, 0x5dcfab0800000000, 0x92efd1b8d0cf37be, 0x5aa1cae500000000,
+    0xb7abc627050305ad, 0xf14a3d9e40000000, 0xe596b7b0c643c719, 0x6d9ccd05d0000000,
+    0x8f7e32ce7bea5c6f, 0xe4820023a2000000, 0xb35dbf821ae4f38b, 0xdda2802c8a800000,
+    0xe0352f62a19e306e, 0xd50b2037ad200000, 0x8c213d9da502de45, 0x4526f422cc340000,
+    0xaf298d050e4395d6, 0x9670b12b7f410000, 0xdaf3f04651d47b4c, 0x3c0cdd765f114000,
+    0x88d8762bf324cd0f, 0xa5880a69fb6ac800, 0xab0e93b6efee0053, 0x8eea0d047a457a00,
+    0xd5d238a4abe98068, 0x72a4904598d6d880, 0x85a36366eb71f041, 0x47a6da2b7f864750,
+    0xa70c3c40a64e6c51, 0x999090b65f67d924, 0xd0cf4b50cfe20765, 0xfff4b4e3f741cf6d,
+    0x82818f1281ed449f, 0xbff8f10e7a8921a4, 0xa321f2d7226895c7, 0xaff72d52192b6a0d,
+    0xcbea6f8ceb02bb39, 0x9bf4f8a69f764490, 0xfee50b7025c36a08, 0x02f236d04753d5b4,
+    0x9f4f2726179a2245, 0x01d762422c946590, 0xc722f0ef9d80aad6, 0x424d3ad2b7b97ef5,
+    0xf8ebad2b84e0d58b, 0xd2e0898765a7deb2, 0x9b934c3b330c8577, 0x63cc55f49f88eb2f,
+    0xc2781f49ffcfa6d5, 0x3cbf6b71c76b25fb, 0xf316271c7fc3908a, 0x8bef464e3945ef7a,
+    0x97edd871cfda3a56, 0x97758bf0e3cbb5ac, 0xbde94e8e43d0c8ec, 0x3d52eeed1cbea317,
+    0xed63a231d4c4fb27, 0x4ca7aaa863ee4bdd, 0x945e455f24fb1cf8, 0x8fe8caa93e74ef6a,
+    0xb975d6b6ee39e436, 0xb3e2fd538e122b44, 0xe7d34c64a9c85d44, 0x60dbbca87196b616,
+    0x90e40fbeea1d3a4a, 0xbc8955e946fe31cd, 0xb51d13aea4a488dd, 0x6babab6398bdbe41,
+    0xe264589a4dcdab14, 0xc696963c7eed2dd1, 0x8d7eb76070a08aec, 0xfc1e1de5cf543ca2,
+    0xb0de65388cc8ada8, 0x3b25a55f43294bcb, 0xdd15fe86affad912, 0x49ef0eb713f39ebe,
+    0x8a2dbf142dfcc7ab, 0x6e3569326c784337, 0xacb92ed9397bf996, 0x49c2c37f07965404,
+    0xd7e77a8f87daf7fb, 0xdc33745ec97be906, 0x86f0ac99b4e8dafd, 0x69a028bb3ded71a3,
+    0xa8acd7c0222311bc, 0xc40832ea0d68ce0c, 0xd2d80db02aabd62b, 0xf50a3fa490c30190,
+    0x83c7088e1aab65db, 0x792667c6da79e0fa, 0xa4b8cab1a1563f52, 0x577001b891185938,
+    0xcde6fd5e09abcf26, 0xed4c0226b55e6f86, 0x80b05e5ac60b6178, 0x544f8158315b05b4,
+    0xa0dc75f1778e39d6, 0x696361ae3db1c721, 0xc913936dd571c84c, 0x03bc3a19cd1e38e9,
+    0xfb5878494ace3a5f, 0x04ab48a04065c723, 0x9d174b2dcec0e47b, 0x62eb0d64283f9c76,
+    0xc45d1df942711d9a, 0x3ba5d0bd324f8394, 0xf5746577930d6500, 0xca8f44ec7ee36479,
+    0x9968bf6abbe85f20, 0x7e998b13cf4e1ecb, 0xbfc2ef456ae276e8, 0x9e3fedd8c321a67e,
+    0xefb3ab16c59b14a2, 0xc5cfe94ef3ea101e, 0x95d04aee3b80ece5, 0xbba1f1d158724a12,
+    0xbb445da9ca61281f, 0x2a8a6e45ae8edc97, 0xea1575143cf97226, 0xf52d09d71a3293bd,
+    0x924d692ca61be758, 0x593c2626705f9c56, 0xb6e0c377cfa2e12e, 0x6f8b2fb00c77836c,
+    0xe498f455c38b997a, 0x0b6dfb9c0f956447, 0x8edf98b59a373fec, 0x4724bd4189bd5eac,
+    0xb2977ee300c50fe7, 0x58edec91ec2cb657, 0xdf3d5e9bc0f653e1, 0x2f2967b66737e3ed,
+    0x8b865b215899f46c, 0xbd79e0d20082ee74, 0xae67f1e9aec07187, 0xecd8590680a3aa11,
+    0xda01ee641a708de9, 0xe80e6f4820cc9495, 0x884134fe908658b2, 0x3109058d147fdcdd,
+    0xaa51823e34a7eede, 0xbd4b46f0599fd415, 0xd4e5e2cdc1d1ea96, 0x6c9e18ac7007c91a,
+    0x850fadc09923329e, 0x03e2cf6bc604ddb0, 0xa6539930bf6bff45, 0x84db8346b786151c,
+    0xcfe87f7cef46ff16, 0xe612641865679a63, 0x81f14fae158c5f6e, 0x4fcb7e8f3f60c07e,
+    0xa26da3999aef7749, 0xe3be5e330f38f09d, 0xcb090c8001ab551c, 0x5cadf5bfd3072cc5,
+    0xfdcb4fa002162a63, 0x73d9732fc7c8f7f6, 0x9e9f11c4014dda7e, 0x2867e7fddcdd9afa,
+    0xc646d63501a1511d, 0xb281e1fd541501b8, 0xf7d88bc24209a565, 0x1f225a7ca91a4226,
+    0x9ae757596946075f, 0x3375788de9b06958, 0xc1a12d2fc3978937, 0x0052d6b1641c83ae,
+    0xf209787bb47d6b84, 0xc0678c5dbd23a49a, 0x9745eb4d50ce6332, 0xf840b7ba963646e0,
+    0xbd176620a501fbff, 0xb650e5a93bc3d898, 0xec5d3fa8ce427aff, 0xa3e51f138ab4cebe,
+    0x93ba47c980e98cdf, 0xc66f336c36b10137, 0xb8a8d9bbe123f017, 0xb80b0047445d4184,
+    0xe6d3102ad96cec1d, 0xa60dc059157491e5, 0x9043ea1ac7e41392, 0x87c89837ad68db2f,
+    0xb454e4a179dd1877, 0x29babe4598c311fb, 0xe16a1dc9d8545e94, 0xf4296dd6fef3d67a,
+    0x8ce2529e2734bb1d, 0x1899e4a65f58660c, 0xb01ae745b101e9e4, 0x5ec05dcff72e7f8f,
+    0xdc21a1171d42645d, 0x76707543f4fa1f73, 0x899504ae72497eba, 0x6a06494a791c53a8,
+    0xabfa45da0edbde69, 0x0487db9d17636892, 0xd6f8d7509292d603, 0x45a9d2845d3c42b6,
+    0x865b86925b9bc5c2, 0x0b8a2392ba45a9b2, 0xa7f26836f282b732, 0x8e6cac7768d7141e,
+    0xd1ef0244af2364ff, 0x3207d795430cd926, 0x8335616aed761f1f, 0x7f44e6bd49e807b8,
+    0xa402b9c5a8d3a6e7, 0x5f16206c9c6209a6, 0xcd036837130890a1, 0x36dba887c37a8c0f,
+    0x802221226be55a64, 0xc2494954da2c9789, 0xa02aa96b06deb0fd, 0xf2db9baa10b7bd6c,
+    0xc83553c5c8965d3d, 0x6f92829494e5acc7, 0xfa42a8b73abbf48c, 0xcb772339ba1f17f9,
+    0x9c69a97284b578d7, 0xff2a760414536efb, 0xc38413cf25e2d70d, 0xfef5138519684aba,
+    0xf46518c2ef5b8cd1, 0x7eb258665fc25d69, 0x98bf2f79d5993802, 0xef2f773ffbd97a61,
+    0xbeeefb584aff8603, 0xaafb550ffacfd8fa, 0xeeaaba2e5dbf6784, 0x95ba2a53f983cf38,
+    0x952ab45cfa97a0b2, 0xdd945a747bf26183, 0xba756174393d88df, 0x94f971119aeef9e4,
+    0xe912b9d1478ceb17, 0x7a37cd5601aab85d, 0x91abb422ccb812ee, 0xac62e055c10ab33a,
+    0xb616a12b7fe617aa, 0x577b986b314d6009, 0xe39c49765fdf9d94, 0xed5a7e85fda0b80b,
+    0x8e41ade9fbebc27d, 0x14588f13be847307, 0xb1d219647ae6b31c, 0x596eb2d8ae258fc8,
+    0xde469fbd99a05fe3, 0x6fca5f8ed9aef3bb, 0x8aec23d680043bee, 0x25de7bb9480d5854,
+    0xada72ccc20054ae9, 0xaf561aa79a10ae6a, 0xd910f7ff28069da4, 0x1b2ba1518094da04,
+    0x87aa9aff79042286, 0x90fb44d2f05d0842, 0xa99541bf57452b28, 0x353a1607ac744a53,
+    0xd3fa922f2d1675f2, 0x42889b8997915ce8, 0x847c9b5d7c2e09b7, 0x69956135febada11,
+    0xa59bc234db398c25, 0x43fab9837e699095, 0xcf02b2c21207ef2e, 0x94f967e45e03f4bb,
+    0x8161afb94b44f57d, 0x1d1be0eebac278f5, 0xa1ba1ba79e1632dc, 0x6462d92a69731732,
+    0xca28a291859bbf93, 0x7d7b8f7503cfdcfe, 0xfcb2cb35e702af78, 0x5cda735244c3d43e,
+    0x9defbf01b061adab, 0x3a0888136afa64a7, 0xc56baec21c7a1916, 0x088aaa1845b8fdd0,
+    0xf6c69a72a3989f5b, 0x8aad549e57273d45, 0x9a3c2087a63f6399, 0x36ac54e2f678864b,
+    0xc0cb28a98fcf3c7f, 0x84576a1bb416a7dd, 0xf0fdf2d3f3c30b9f, 0x656d44a2a11c51d5,
+    0x969eb7c47859e743, 0x9f644ae5a4b1b325, 0xbc4665b596706114, 0x873d5d9f0dde1fee,
+    0xeb57ff22fc0c7959, 0xa90cb506d155a7ea, 0x9316ff75dd87cbd8, 0x09a7f12442d588f2,
+    0xb7dcbf5354e9bece, 0x0c11ed6d538aeb2f, 0xe5d3ef282a242e81, 0x8f1668c8a86da5fa,
+    0x8fa475791a569d10, 0xf96e017d694487bc, 0xb38d92d760ec4455, 0x37c981dcc395a9ac,
+    0xe070f78d3927556a, 0x85bbe253f47b1417, 0x8c469ab843b89562, 0x93956d7478ccec8e,
+    0xaf58416654a6babb, 0x387ac8d1970027b2, 0xdb2e51bfe9d0696a, 0x06997b05fcc0319e,
+    0x88fcf317f22241e2, 0x441fece3bdf81f03, 0xab3c2fddeeaad25a, 0xd527e81cad7626c3,
+    0xd60b3bd56a5586f1, 0x8a71e223d8d3b074, 0x85c7056562757456, 0xf6872d5667844e49,
+    0xa738c6bebb12d16c, 0xb428f8ac016561db, 0xd106f86e69d785c7, 0xe13336d701beba52,
+    0x82a45b450226b39c, 0xecc0024661173473, 0xa34d721642b06084, 0x27f002d7f95d0190,
+    0xcc20ce9bd35c78a5, 0x31ec038df7b441f4, 0xff290242c83396ce, 0x7e67047175a15271,
+    0x9f79a169bd203e41, 0x0f0062c6e984d386, 0xc75809c42c684dd1, 0x52c07b78a3e60868,
+    0xf92e0c3537826145, 0xa7709a56ccdf8a82, 0x9bbcc7a142b17ccb, 0x88a66076400bb691,
+    0xc2abf989935ddbfe, 0x6acff893d00ea435, 0xf356f7ebf83552fe, 0x0583f6b8c4124d43,
+    0x98165af37b2153de, 0xc3727a337a8b704a, 0xbe1bf1b059e9a8d6, 0x744f18c0592e4c5c,
+    0xeda2ee1c7064130c, 0x1162def06f79df73, 0x9485d4d1c63e8be7, 0x8addcb5645ac2ba8,
+    0xb9a74a0637ce2ee1, 0x6d953e2bd7173692, 0xe8111c87c5c1ba99, 0xc8fa8db6ccdd0437,
+    0x910ab1d4db9914a0, 0x1d9c9892400a22a2, 0xb54d5e4a127f59c8, 0x2503beb6d00cab4b,
+    0xe2a0b5dc971f303a, 0x2e44ae64840fd61d, 0x8da471a9de737e24, 0x5ceaecfed289e5d2,
+    0xb10d8e1456105dad, 0x7425a83e872c5f47, 0xdd50f1996b947518, 0xd12f124e28f77719,
+    0x8a5296ffe33cc92f, 0x82bd6b70d99aaa6f, 0xace73cbfdc0bfb7b, 0x636cc64d1001550b,
+    0xd8210befd30efa5a, 0x3c47f7e05401aa4e, 0x8714a775e3e95c78, 0x65acfaec34810a71,
+    0xa8d9d1535ce3b396, 0x7f1839a741a14d0d, 0xd31045a8341ca07c, 0x1ede48111209a050,
+    0x83ea2b892091e44d, 0x934aed0aab460432, 0xa4e4b66b68b65d60, 0xf81da84d5617853f,
+    0xce1de40642e3f4b9, 0x36251260ab9d668e, 0x80d2ae83e9ce78f3, 0xc1d72b7c6b426019,
+    0xa1075a24e4421730, 0xb24cf65b8612f81f, 0xc94930ae1d529cfc, 0xdee033f26797b627,
+    0xfb9b7cd9a4a7443c, 0x169840ef017da3b1, 0x9d412e0806e88aa5, 0x8e1f289560ee864e,
+    0xc491798a08a2ad4e, 0xf1a6f2bab92a27e2, 0xf5b5d7ec8acb58a2, 0xae10af696774b1db,
+    0x9991a6f3d6bf1765, 0xacca6da1e0a8ef29, 0xbff610b0cc6edd3f, 0x17fd090a58d32af3,
+    0xeff394dcff8a948e, 0xddfc4b4cef07f5b0, 0x95f83d0a1fb69cd9, 0x4abdaf101564f98e,
+    0xbb764c4ca7a4440f, 0x9d6d1ad41abe37f1, 0xea53df5fd18d5513, 0x84c86189216dc5ed,
+    0x92746b9be2f8552c, 0x32fd3cf5b4e49bb4, 0xb7118682dbb66a77, 0x3fbc8c33221dc2a1,
+    0xe4d5e82392a40515, 0x0fabaf3feaa5334a, 0x8f05b1163ba6832d, 0x29cb4d87f2a7400e,
+    0xb2c71d5bca9023f8, 0x743e20e9ef511012, 0xdf78e4b2bd342cf6, 0x914da9246b255416,
+    0x8bab8eefb6409c1a, 0x1ad089b6c2f7548e, 0xae9672aba3d0c320, 0xa184ac2473b529b1,
+    0xda3c0f568cc4f3e8, 0xc9e5d72d90a2741e, 0x8865899617fb1871, 0x7e2fa67c7a658892,
+    0xaa7eebfb9df9de8d, 0xddbb901b98feeab7, 0xd51ea6fa85785631, 0x552a74227f3ea565,
+    0x8533285c936b35de, 0xd53a88958f87275f, 0xa67ff273b8460356, 0x8a892abaf368f137,
+    0xd01fef10a657842c, 0x2d2b7569b0432d85, 0x8213f56a67f6b29b, 0x9c3b29620e29fc73,
+    0xa298f2c501f45f42, 0x8349f3ba91b47b8f, 0xcb3f2f7642717713, 0x241c70a936219a73,
+    0xfe0efb53d30dd4d7, 0xed238cd383aa0110, 0x9ec95d1463e8a506, 0xf4363804324a40aa,
+    0xc67bb4597ce2ce48, 0xb143c6053edcd0d5, 0xf81aa16fdc1b81da, 0xdd94b7868e94050a,
+    0x9b10a4e5e9913128, 0xca7cf2b4191c8326, 0xc1d4ce1f63f57d72, 0xfd1c2f611f63a3f0,
+    0xf24a01a73cf2dccf, 0xbc633b39673c8cec, 0x976e41088617ca01, 0xd5be0503e085d813,
+    0xbd49d14aa79dbc82, 0x4b2d8644d8a74e18, 0xec9c459d51852ba2, 0xddf8e7d60ed1219e,
+    0x93e1ab8252f33b45, 0xcabb90e5c942b503, 0xb8da1662e7b00a17, 0x3d6a751f3b936243,
+    0xe7109bfba19c0c9d, 0x0cc512670a783ad4, 0x906a617d450187e2, 0x27fb2b80668b24c5,
+    0xb484f9dc9641e9da, 0xb1f9f660802dedf6, 0xe1a63853bbd26451, 0x5e7873f8a0396973,
+    0x8d07e33455637eb2, 0xdb0b487b6423e1e8, 0xb049dc016abc5e5f, 0x91ce1a9a3d2cda62,
+    0xdc5c5301c56b75f7, 0x7641a140cc7810fb, 0x89b9b3e11b6329ba, 0xa9e904c87fcb0a9d,
+    0xac2820d9623bf429, 0x546345fa9fbdcd44, 0xd732290fbacaf133, 0xa97c177947ad4095,
+    0x867f59a9d4bed6c0, 0x49ed8eabcccc485d, 0xa81f301449ee8c70, 0x5c68f256bfff5a74,
+    0xd226fc195c6a2f8c, 0x73832eec6fff3111, 0x83585d8fd9c25db7, 0xc831fd53c5ff7eab,
+    0xa42e74f3d032f525, 0xba3e7ca8b77f5e55, 0xcd3a1230c43fb26f, 0x28ce1bd2e55f35eb,
+    0x80444b5e7aa7cf85, 0x7980d163cf5b81b3, 0xa0555e361951c366, 0xd7e105bcc332621f,
+    0xc86ab5c39fa63440, 0x8dd9472bf3fefaa7, 0xfa856334878fc150, 0xb14f98f6f0feb951,
+    0x9c935e00d4b9d8d2, 0x6ed1bf9a569f33d3, 0xc3b8358109e84f07, 0x0a862f80ec4700c8,
+    0xf4a642e14c6262c8, 0xcd27bb612758c0fa, 0x98e7e9cccfbd7dbd, 0x8038d51cb897789c,
+    0xbf21e44003acdd2c, 0xe0470a63e6bd56c3, 0xeeea5d5004981478, 0x1858ccfce06cac74,
+    0x95527a5202df0ccb, 0x0f37801e0c43ebc8, 0xbaa718e68396cffd, 0xd30560258f54e6ba,
+    0xe950df20247c83fd, 0x47c6b82ef32a2069, 0x91d28b7416cdd27e, 0x4cdc331d57fa5441,
+    0xb6472e511c81471d, 0xe0133fe4adf8e952, 0xe3d8f9e563a198e5, 0x58180fddd97723a6,
+    0x8e679c2f5e44ff8f, 0x570f09eaa7ea7648
+};
+
+/**
+ * Converts w * 10^q to the bits of the nearest double with the Eisel-Lemire algorithm. Returns false in the rare
+ * cases where the 128-bit product cannot decide the rounding.
+ */
+static bool str_eisel_lemire(uint64_t w, int64_t q, uint64_t *bits)
+{
+    if (w == 0 || q < STR_POWER_OF_FIVE_MIN) {
+        *bits = 0;
+        return true;
+    }
+
+    if (q > STR_POWER_OF_FIVE_MAX) {
+        *bits = (uint64_t) 0x7ff << 52;
+        return true;
+    }
+
+    const int lz = str_leading_zeros64(w);
+    const int64_t index = 2 * (q - STR_POWER_OF_FIVE_MIN);
+    uint64_t high;
+    uint64_t low;
+
+    w <<= lz;
+    low = str_mul128(w, str_power_of_five_128[index], &high);
+
+    /* Only the top 55 bits are needed: refine with the low word of the power when a carry could reach them */
+    const uint64_t precision_mask = UINT64_MAX >> 55;
+
+    if ((high & precision_mask) == precision_mask) {
+        uint64_t second;
+        str_mul128(w, str_power_of_five_128[index + 1], &second);
+        low += second;
+        high += second > low;
+
+        if ((high & precision_mask) == precision_mask && low == UINT64_MAX && (q < -27 || q > 55)) {
+            return false;
+        }
+    }
+
+    const int upper_bit = (int) (high >> 63);
+    const int shift = upper_bit + 64 - 52 - 3;
+    uint64_t mantissa = high >> shift;
+
+    /* floor(log2(10^q)) + 63 with a fixed-point approximation, plus the exponent bias */
+    int64_t power2 = (((152170 + 65536) * q) >> 16) + 63 + upper_bit - lz + 1023;
+
+    if (power2 <= 0) {
+        /* Subnormal: exact halfway cases cannot happen this far from 10^0, so rounding half up is correct */
+        if (-power2 + 1 >= 64) {
+            *bits = 0;
+            return true;
+        }
+
+        mantissa >>= -power2 + 1;
+        mantissa += mantissa & 1;
+        mantissa >>= 1;
+
+        /* Rounding may carry into the smallest normal exponent, which sets bit 52 */
+        *bits = mantissa;
+        return true;
+    }
+
+    /* An exact halfway case rounds to even; the product can only be exact for small exponents */
+    if (low <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1 && (mantissa << shift) == high) {
+        mantissa &= ~(uint64_t) 1;
+    }
+
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+
+    if (mantissa >= ((uint64_t) 2 << 52)) {
+        mantissa = (uint64_t) 1 << 52;
+        power2++;
+    }
+
+    if (power2 >= 0x7ff) {
+        *bits = (uint64_t) 0x7ff << 52;
+        return true;
+    }
+
+    *bits = (mantissa & (((uint64_t) 1 << 52) - 1)) | (uint64_t) power2 << 52;
+    return true;
+}
+
+/**
+ * An arbitrary-precision decimal 0.d1d2d3... * 10^point, used to round the inputs that the Eisel-Lemire
+ * algorithm cannot decide. Digits are stored as values 0 to 9; digits past STR_DECIMAL_MAX_DIGITS are dropped
+ * and only recorded in the truncated flag, which is enough to break ties.
+ */
+struct StrDecimal
+{
+    int count;
+    int64_t point;
+    bool truncated;
+    unsigned char digits[STR_DECIMAL_MAX_DIGITS];
+};
+
+static void str_decimal_trim(struct StrDecimal *d)
+{
+    while (d->count > 0 && d->digits[d->count - 1] == 0) {
+        d->count--;
+    }
+
+    if (d->count == 0) {
+        d->point = 0;
+    }
+}
+
+/**
+ * Reads the validated digits of a number, with an optional '.', and applies its decimal exponent.
+ */
+static void str_decimal_init(struct StrDecimal *d, const char *s, const char *e, int64_t exponent)
+{
+    bool dot = false;
+
+    d->count = 0;
+    d->point = 0;
+    d->truncated = false;
+
+    for (; s < e; s++) {
+        if (*s == '.') {
+            dot = true;
+            continue;
+        }
+
+        const unsigned char digit = (unsigned char) (*s - '0');
+
+        if (d->count == 0 && digit == 0) {
+            /* Leading zeros only move the point when they follow it */
+            d->point -= dot;
+            continue;
+        }
+
+        d->point += !dot;
+
+        if (d->count < STR_DECIMAL_MAX_DIGITS) {
+            d->digits[d->count++] = digit;
+        } else if (digit != 0) {
+            d->truncated = true;
+        }
+    }
+
+    str_decimal_trim(d);
+
+    if (d->count > 0) {
+        d->point += exponent;
+    }
+}
+
+/**
+ * Multiplies the decimal by 2^k, for k up to STR_DECIMAL_MAX_SHIFT.
+ */
+static void str_decimal_shift_left(struct StrDecimal *d, int k)
+{
+    unsigned char out[STR_DECIMAL_MAX_DIGITS + 20];
+    int w = (int) sizeof(out);
+    uint64_t n = 0;
+
+    /* Multiply from the last digit, writing the result backwards from the end of out */
+    for (int r = d->count - 1; r >= 0; r--) {
+        n += (uint64_t) d->digits[r] << k;
+        out[--w] = (unsigned char) (n % 10);
+        n /= 10;
+    }
+
+    for (; n > 0; n /= 10) {
+        out[--w] = (unsigned char) (n % 10);
+    }
+
+    const int produced = (int) sizeof(out) - w;
+    const int kept = MIN(produced, STR_DECIMAL_MAX_DIGITS);
+
+    for (int i = kept; i < produced; i++) {
+        d->truncated |= out[w + i] != 0;
+    }
+
+    memcpy(d->digits, out + w, kept);
+    d->point += produced - d->count;
+    d->count = kept;
+    str_decimal_trim(d);
+}
+
+/**
+ * Divides the decimal by 2^k, for k up to STR_DECIMAL_MAX_SHIFT.
+ */
+static void str_decimal_shift_right(struct StrDecimal *d, int k)
+{
+    const uint64_t mask = ((uint64_t) 1 << k) - 1;
+    uint64_t n = 0;
+    int r = 0;
+    int w = 0;
+
+    /* Read digits until there is something to divide */
+    for (; (n >> k) == 0; r++) {
+        if (r >= d->count) {
+            if (n == 0) {
+                d->count = 0;
+                d->point = 0;
+                return;
+            }
+
+            while ((n >> k) == 0) {
+                n *= 10;
+                r++;
+            }
+
+            break;
+        }
+
+        n = n * 10 + d->digits[r];
+    }
+
+    d->point -= r - 1;
+
+    for (; r < d->count; r++) {
+        d->digits[w++] = (unsigned char) (n >> k);
+        n = (n & mask) * 10 + d->digits[r];
+    }
+
+    for (; n > 0; n = (n & mask) * 10) {
+        const unsigned char digit = (unsigned char) (n >> k);
+
+        if (w < STR_DECIMAL_MAX_DIGITS) {
+            d->digits[w++] = digit;
+        } else if (digit != 0) {
+            d->truncated = true;
+        }
+    }
+
+    d->count = w;
+    str_decimal_trim(d);
+}
+
+static void str_decimal_shift(struct StrDecimal *d, int k)
+{
+    for (; k > STR_DECIMAL_MAX_SHIFT; k -= STR_DECIMAL_MAX_SHIFT) {
+        str_decimal_shift_left(d, STR_DECIMAL_MAX_SHIFT);
+    }
+
+    for (; k < -STR_DECIMAL_MAX_SHIFT; k += STR_DECIMAL_MAX_SHIFT) {
+        str_decimal_shift_right(d, STR_DECIMAL_MAX_SHIFT);
+    }
+
+    if (k > 0) {
+        str_decimal_shift_left(d, k);
+    } else if (k < 0) {
+        str_decimal_shift_right(d, -k);
+    }
+}
+
+/**
+ * Returns the integer part of the decimal, rounded half to even on its first fractional digit.
+ */
+static uint64_t str_decimal_rounded_integer(const struct StrDecimal *d)
+{
+    uint64_t n = 0;
+    int64_t i = 0;
+
+    if (d->point > 20) {
+        return UINT64_MAX;
+    }
+
+    for (; i < d->point && i < d->count; i++) {
+        n = n * 10 + d->digits[i];
+    }
+
+    for (; i < d->point; i++) {
+        n *= 10;
+    }
+
+    if (d->point >= 0 && d->point < d->count) {
+        const unsigned char next = d->digits[d->point];
+
+        if (next == 5 && d->point + 1 == d->count) {
+            /* Exactly halfway, unless digits were dropped */
+            n += d->truncated || (n & 1);
+        } else {
+            n += next >= 5;
+        }
+    }
+
+    return n;
+}
+
+/**
+ * Converts the decimal to the bits of the nearest double by scaling it with powers of two into [0.5, 1) and then
+ * extracting 53 bits. Slow but exact for any number of digits.
+ */
+static uint64_t str_decimal_to_double(struct StrDecimal *d)
+{
+    static const int shifts[9] = {1, 3, 6, 9, 13, 16, 19, 23, 26};
+    int64_t exponent = 0;
+
+    if (d->count == 0 || d->point < -330) {
+        return 0;
+    }
+
+    if (d->point > 310) {
+        return (uint64_t) 0x7ff << 52;
+    }
+
+    while (d->point > 0) {
+        const int n = d->point < 9 ? shifts[d->point] : 27;
+        str_decimal_shift(d, -n);
+        exponent += n;
+    }
+
+    while (d->point < 0 || (d->point == 0 && d->digits[0] < 5)) {
+        const int n = -d->point < 9 ? shifts[-d->point] : 27;
+        str_decimal_shift(d, n);
+        exponent -= n;
+    }
+
+    /* The range of doubles is [1, 2) rather than [0.5, 1) */
+    exponent--;
+
+    /* Below the smallest normal exponent, denormalize */
+    if (exponent < -1022) {
+        const int n = (int) (-1022 - exponent);
+        str_decimal_shift(d, -n);
+        exponent += n;
+    }
+
+    if (exponent + 1023 >= 0x7ff) {
+        return (uint64_t) 0x7ff << 52;
+    }
+
+    str_decimal_shift(d, 53);
+    uint64_t mantissa = str_decimal_rounded_integer(d);
+
+    /* Rounding may have carried into a 54th bit */
+    if (mantissa == (uint64_t) 2 << 52) {
+        mantissa >>= 1;
+        exponent++;
+
+        if (exponent + 1023 >= 0x7ff) {
+            return (uint64_t) 0x7ff << 52;
+        }
+    }
+
+    if ((mantissa & ((uint64_t) 1 << 52)) == 0) {
+        /* Subnormal */
+        exponent = -1023;
+    }
+
+    return (mantissa & (((uint64_t) 1 << 52) - 1)) | (uint64_t) (exponent + 1023) << 52;
+}
+
+/**
+ * Sets the decimal to the odd integer n times 2^e, exactly: a double and the boundaries of its rounding interval
+ * have at most 768 significant digits.
+ */
+static void str_decimal_init_binary(struct StrDecimal *d, uint64_t n, int e)
+{
+    char buffer[20];
+    const int digits = str_count_digits(n);
+
+    str_write_decimal(buffer + digits, n);
+    for (int i = 0; i < digits; i++) {
+        d->digits[i] = (unsigned char) (buffer[i] - '0');
+    }
+
+    d->count = digits;
+    d->point = digits;
+    d->truncated = false;
+    str_decimal_trim(d);
+    str_decimal_shift(d, e);
+}
+
+/**
+ * Keeps the first n digits of the decimal, rounding the magnitude up.
+ */
+static void str_decimal_round_up(struct StrDecimal *d, int n)
+{
+    for (int i = n - 1; i >= 0; i--) {
+        if (d->digits[i] < 9) {
+            d->digits[i]++;
+            d->count = i + 1;
+            return;
+        }
+    }
+
+    /* All nines: 0.999 becomes 1.000 */
+    d->digits[0] = 1;
+    d->count = 1;
+    d->point++;
+}
+
+/**
+ * Generates the shortest digits of the positive double m * 2^e that parse back to it, picking the closest
+ * candidate. The boundaries of the rounding interval are included when m is even, since the parser rounds ties
+ * to even. Exact but slow: used when str_grisu3() cannot decide. Returns the number of digits (at most 17).
+ */
+static int str_shortest_exact(uint64_t m, int e, bool lower_closer, char *buffer, int *k)
+{
+    struct StrDecimal d, upper, lower;
+
+    str_decimal_init_binary(&d, m, e);
+    str_decimal_init_binary(&upper, 2 * m + 1, e - 1);
+    if (lower_closer) {
+        str_decimal_init_binary(&lower, 4 * m - 1, e - 2);
+    } else {
+        str_decimal_init_binary(&lower, 2 * m - 1, e - 1);
+    }
+
+    /*
+     * Walk the digits of the upper boundary and find the first position where the value can be cut: rounding
+     * down stays above the lower boundary, rounding up stays below the upper one. The indices of the value and the
+     * lower boundary are aligned on the decimal point of the upper boundary.
+     */
+    const bool inclusive = (m & 1) == 0;
+    int upper_delta = 0;
+
+    for (int ui = 0;; ui++) {
+        const int mi = ui - (int) (upper.point - d.point);
+        if (mi >= d.count) {
+            break;
+        }
+
+        const int li = ui - (int) (upper.point - lower.point);
+        const unsigned char l = li >= 0 && li < lower.count ? lower.digits[li] : 0;
+        const unsigned char v = mi >= 0 ? d.digits[mi] : 0;
+        const unsigned char u = ui < upper.count ? upper.digits[ui] : 0;
+
+        /* Whether the value and the upper boundary differ by more than one unit of the digit so far */
+        if (upper_delta == 0 && v + 1 < u) {
+            upper_delta = 2;
+        } else if (upper_delta == 0 && v != u) {
+            upper_delta = 1;
+        } else if (upper_delta == 1 && (v != 9 || u != 0)) {
+            upper_delta = 2;
+        }
+
+        const bool down = l != v || (inclusive && li + 1 == lower.count);
+        const bool up = upper_delta > 0 && (inclusive || upper_delta > 1 || ui + 1 < upper.count);
+
+        if (down && up) {
+            /* Round to nearest, ties to even */
+            const int n = mi + 1;
+            if (n < d.count && (d.digits[n] > 5 || (d.digits[n] == 5 && (n + 1 < d.count || (d.digits[mi] & 1))))) {
+                str_decimal_round_up(&d, n);
+            } else {
+                d.count = n;
+            }
+            break;
+        }
+
+        if (down) {
+            d.count = mi + 1;
+            break;
+        }
+
+        if (up) {
+            str_decimal_round_up(&d, mi + 1);
+            break;
+        }
+    }
+
+    str_decimal_trim(&d);
+
+    for (int i = 0; i < d.count; i++) {
+        buffer[i] = (char) ('0' + d.digits[i]);
+    }
+
+    *k = (int) d.point - d.count;
+    return d.count;
+}
+
+StrParseResult str_parse_double_str(const char *s, int64_t length, double *value, int64_t *consumed)
+{
+    static const double pow10[23] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    if (length < 0) {
+        length = str_get_len(s);
+    }
+
+    const char *e = s + length;
+    const char *p = s;
+    const bool negative = p < e && *p == '-';
+
+    if (p < e && (*p == '-' || *p == '+')) {
+        p++;
+    }
+
+    /* Special values */
+    if (str_match_word(p, e, "nan", 3) || str_match_word(p, e, "inf", 3)) {
+        const bool nan = (*p | 0x20) == 'n';
+
+        *value = nan ? NAN : (negative ? -HUGE_VAL : HUGE_VAL);
+        p += str_match_word(p, e, "infinity", 8) ? 8 : 3;
+
+        if (consumed) {
+            *consumed = p - s;
+        }
+
+        return STR_PARSE_OK;
+    }
+
+    /* Significand: up to 19 significant digits are kept in an integer */
+    uint64_t mantissa = 0;
+    int64_t exponent = 0;
+    int64_t digits = 0;
+    int64_t significant = 0;
+    const char *start = p;
+
+    for (; p < e && *p >= '0' && *p <= '9'; p++, digits++) {
+        if (significant < 19) {
+            mantissa = mantissa * 10 + (unsigned) (*p - '0');
+            significant += mantissa != 0;
+        } else {
+            exponent++;
+            significant++;
+        }
+    }
+
+    if (p < e && *p == '.') {
+        p++;
+
+        for (; p < e && *p >= '0' && *p <= '9'; p++, digits++) {
+            if (significant < 19) {
+                mantissa = mantissa * 10 + (unsigned) (*p - '0');
+                significant += mantissa != 0;
+                exponent--;
+            } else {
+                significant++;
+            }
+        }
+    }
+
+    if (digits == 0) {
+        *value = 0;
+        if (consumed) {
+            *consumed = 0;
+        }
+
+        return STR_PARSE_INVALID;
+    }
+
+    const char *digits_end = p;
+    int64_t decimal_exponent = 0;
+
+    /* Exponent, only consumed if it has digits */
+    if (p < e && (*p | 0x20) == 'e') {
+        const char *q = p + 1;
+        const bool negative_exponent = q < e && *q == '-';
+        bool overflow = false;
+        uint64_t explicit_exponent;
+
+        if (q < e && (*q == '-' || *q == '+')) {
+            q++;
+        }
+
+        const char *end = str_parse_digits(q, e, &explicit_exponent, &overflow);
+        if (end > q) {
+            if (overflow || explicit_exponent > 100000) {
+                explicit_exponent = 100000;
+            }
+
+            decimal_exponent = negative_exponent ? -(int64_t) explicit_exponent : (int64_t) explicit_exponent;
+            exponent += decimal_exponent;
+            p = end;
+        }
+    }
+
+    if (consumed) {
+        *consumed = p - s;
+    }
+
+    double result;
+
+#if FLT_EVAL_METHOD == 0
+    /* Clinger's fast path: both operands are exact, so the single rounding of the operation is correct */
+    if (significant <= 19 && mantissa <= ((uint64_t) 1 << 53) && exponent >= -22 && exponent <= 22 + 15) {
+        if (exponent > 22) {
+            /* Move part of the exponent into the mantissa while it stays exact */
+            for (; exponent > 22 && mantissa <= ((uint64_t) 1 << 53) / 10; exponent--) {
+                mantissa *= 10;
+            }
+        }
+
+        if (exponent <= 22) {
+            result = (double) mantissa;
+            result = exponent < 0 ? result / pow10[-exponent] : result * pow10[exponent];
+            *value = negative ? -result : result;
+            return STR_PARSE_OK;
+        }
+    }
+#endif
+
+    uint64_t bits;
+    bool decided = str_eisel_lemire(mantissa, exponent, &bits);
+
+    if (decided && significant > 19) {
+        /* Digits past the 19th were dropped: the value lies between mantissa and mantissa + 1 */
+        uint64_t upper;
+        decided = str_eisel_lemire(mantissa + 1, exponent, &upper) && upper == bits;
+    }
+
+    if (!decided) {
+        struct StrDecimal decimal;
+        str_decimal_init(&decimal, start, digits_end, decimal_exponent);
+        bits = str_decimal_to_double(&decimal);
+    }
+
+    memcpy(&result, &bits, sizeof(result));
+    *value = negative ? -result : result;
+
+    if (result == HUGE_VAL) {
+        return STR_PARSE_OVERFLOW;
+    }
+
+    return STR_PARSE_OK;
+}
+
+/**
+ * The seed of str_hash(). Relaxed atomics make a change while other threads hash well defined.
+ */
+static _Atomic uint64_t str_default_hash_seed = 0;
+
+/**
+ * The default secret of wyhash.
+ */
+static const uint64_t str_wyhash_secret[4] = {
+    0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL, 0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL
+};
+
+/**
+ * Multiplies two 64-bit integers and returns the low half of the 128-bit product in a and the high half in b.
+ */
+static inline void str_wymum(uint64_t *a, uint64_t *b)
+{
+    uint64_t high;
+    *a = str_mul128(*a, *b, &high);
+    *b = high;
+}
+
+static inline uint64_t str_wymix(uint64_t a, uint64_t b)
+{
+    str_wymum(&a, &b);
+    return a ^ b;
+}
+
+static inline uint64_t str_wyr8(const unsigned char *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t str_wyr4(const unsigned char *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+void str_set_hash_seed(uint64_t seed)
+{
+    atomic_store_explicit(&str_default_hash_seed, seed, memory_order_relaxed);
+}
+
+uint64_t str_hash_str(const char *s, int64_t length, uint64_t seed)
+{
+    if (length < 0) {
+        length = str_get_len(s);
+    }
+
+    const uint64_t *secret = str_wyhash_secret;
+    const unsigned char *p = (const unsigned char *) s;
+    uint64_t a;
+    uint64_t b;
+
+    seed ^= str_wymix(seed ^ secret[0], secret[1]);
+
+    if (length <= 16) {
+        if (length >= 4) {
+            /* Two overlapping pairs of 4-byte reads cover the whole string */
+            const int64_t middle = (length >> 3) << 2;
+            a = (str_wyr4(p) << 32) | str_wyr4(p + middle);
+            b = (str_wyr4(p + length - 4) << 32) | str_wyr4(p + length - 4 - middle);
+        } else if (length > 0) {
+            a = ((uint64_t) p[0] << 16) | ((uint64_t) p[length >> 1] << 8) | p[length - 1];
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        int64_t i = length;
+
+        if (i >= 48) {
+            /* Three independent lanes to keep the multipliers busy */
+            uint64_t see1 = seed;
+            uint64_t see2 = seed;
+
+            do {
+                seed = str_wymix(str_wyr8(p) ^ secret[1], str_wyr8(p + 8) ^ seed);
+                see1 = str_wymix(str_wyr8(p + 16) ^ secret[2], str_wyr8(p + 24) ^ see1);
+                see2 = str_wymix(str_wyr8(p + 32) ^ secret[3], str_wyr8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i >= 48);
+
+            seed ^= see1 ^ see2;
+        }
+
+        while (i > 16) {
+            seed = str_wymix(str_wyr8(p) ^ secret[1], str_wyr8(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+
+        a = str_wyr8(p + i - 16);
+        b = str_wyr8(p + i - 8);
+    }
+
+    a ^= secret[1];
+    b ^= seed;
+    str_wymum(&a, &b);
+
+    const uint64_t hash = str_wymix(a ^ secret[0] ^ (uint64_t) length, b ^ secret[1]);
+
+    /* 0 marks a hash that has not been computed */
+    return hash != 0 ? hash : 1;
+}
+
+uint64_t str_hash(Str *str)
+{
+    if (str->hash == 0) {
+        const uint64_t seed = atomic_load_explicit(&str_default_hash_seed, memory_order_relaxed);
+        str->hash = str_hash_str(str->value, str->length, seed);
+    }
+
+    return str->hash;
+}
+
+#ifdef STR_HAVE_POSIX
+struct StrPoolEntry
+{
+    uint64_t hash;
+    int64_t length;
+    char value[];
+};
+
+/**
+ * An open-addressing table of entries. Tables replaced by a larger one are kept in the retired list until the pool
+ * is finalized, because readers may still be probing them.
+ */
+struct StrPoolTable
+{
+    struct StrPoolTable *retired;
+    int64_t mask;
+    _Atomic(struct StrPoolEntry *) slots[];
+};
+
+struct StrPoolShard
+{
+    _Alignas(STR_CACHE_LINE) pthread_mutex_t lock;
+    _Atomic(struct StrPoolTable *) table;
+    StrArena arena;
+    int64_t count;
+};
+
+/**
+ * Returns the entry of the table that holds the string, or NULL and the free slot where it belongs.
+ */
+static struct StrPoolEntry *str_pool_probe(struct StrPoolTable *table, uint64_t hash, const char *s, int64_t length, int64_t *slot)
+{
+    for (int64_t i = (int64_t) (hash & table->mask);; i = (i + 1) & table->mask) {
+        struct StrPoolEntry *entry = atomic_load_explicit(&table->slots[i], memory_order_acquire);
+
+        if (entry == NULL || (entry->hash == hash && entry->length == length && memcmp(entry->value, s, length) == 0)) {
+            *slot = i;
+            return entry;
+        }
+    }
+}
+
+static struct StrPoolTable *str_pool_table_new(int64_t capacity)
+{
+    struct StrPoolTable *table = calloc(1, sizeof(struct StrPoolTable) + sizeof(table->slots[0]) * capacity);
+
+    if (table) {
+        table->mask = capacity - 1;
+    }
+
+    return table;
+}
+
+/**
+ * Doubles the table of the shard. The new table is filled before it is published, so readers always see either
+ * the old or the complete new table. Must be called with the lock of the shard held.
+ */
+static bool str_pool_grow(struct StrPoolShard *shard)
+{
+    struct StrPoolTable *old = atomic_load_explicit(&shard->table, memory_order_relaxed);
+    struct StrPoolTable *table = str_pool_table_new((old->mask + 1) * 2);
+
+    if (table == NULL) {
+        return false;
+    }
+
+    for (int64_t i = 0; i <= old->mask; i++) {
+        struct StrPoolEntry *entry = atomic_load_explicit(&old->slots[i], memory_order_relaxed);
+
+        if (entry) {
+            int64_t slot = (int64_t) (entry->hash & table->mask);
+
+            while (atomic_load_explicit(&table->slots[slot], memory_order_relaxed) != NULL) {
+                slot = (slot + 1) & table->mask;
+            }
+
+            atomic_store_explicit(&table->slots[slot], entry, memory_order_relaxed);
+        }
+    }
+
+    table->retired = old;
+    atomic_store_explicit(&shard->table, table, memory_order_release);
+    return true;
+}
+
+static struct StrPoolShard *str_pool_shard(const StrPool *pool, uint64_t hash)
+{
+    /* The top bits pick the shard and the bottom bits the slot, so both stay independent */
+    return &pool->shards[hash >> (64 - STR_INTERN_SHARD_BITS)];
+}
+
+static bool str_pool_intern_hashed(StrPool *pool, const char *s, int64_t length, uint64_t hash, StrView *interned)
+{
+    struct StrPoolShard *shard = str_pool_shard(pool, hash);
+    struct StrPoolTable *table = atomic_load_explicit(&shard->table, memory_order_acquire);
+    int64_t slot;
+    struct StrPoolEntry *entry = str_pool_probe(table, hash, s, length, &slot);
+
+    if (entry == NULL) {
+        pthread_mutex_lock(&shard->lock);
+
+        /* Another thread may have added the string or grown the table since the lookup */
+        table = atomic_load_explicit(&shard->table, memory_order_relaxed);
+        entry = str_pool_probe(table, hash, s, length, &slot);
+
+        if (entry == NULL && (shard->count + 1) * 2 > table->mask + 1) {
+            /* Keep the load factor under 1/2. If the table cannot grow, it still works until it is full */
+            if (str_pool_grow(shard)) {
+                table = atomic_load_explicit(&shard->table, memory_order_relaxed);
+                str_pool_probe(table, hash, s, length, &slot);
+            } else if (shard->count + 1 > table->mask) {
+                pthread_mutex_unlock(&shard->lock);
+                return false;
+            }
+        }
+
+        if (entry == NULL) {
+            entry = str_arena_allocate(&shard->arena, (int64_t) sizeof(struct StrPoolEntry) + length + 1);
+
+            if (entry) {
+                entry->hash = hash;
+                entry->length = length;
+                memcpy(entry->value, s, length);
+                entry->value[length] = '\0';
+
+                /* Publishes the filled entry to the readers */
+                atomic_store_explicit(&table->slots[slot], entry, memory_order_release);
+                shard->count++;
+            }
+        }
+
+        pthread_mutex_unlock(&shard->lock);
+
+        if (entry == NULL) {
+            return false;
+        }
+    }
+
+    interned->value = entry->value;
+    interned->length = entry->length;
+    return true;
+}
+
+bool str_pool_init(StrPool *pool)
+{
+    pool->seed = atomic_load_explicit(&str_default_hash_seed, memory_order_relaxed);
+    pool->shards = aligned_alloc(STR_CACHE_LINE, sizeof(struct StrPoolShard) * STR_INTERN_SHARDS);
+
+    if (pool->shards == NULL) {
+        return false;
+    }
+
+    for (int i = 0; i < STR_INTERN_SHARDS; i++) {
+        struct StrPoolShard *shard = &pool->shards[i];
+        struct StrPoolTable *table = str_pool_table_new(STR_INTERN_INITIAL_CAPACITY);
+
+        if (table == NULL) {
+            while (i-- > 0) {
+                free(atomic_load_explicit(&pool->shards[i].table, memory_order_relaxed));
+                pthread_mutex_destroy(&pool->shards[i].lock);
+            }
+
+            free(pool->shards);
+            pool->shards = NULL;
+            return false;
+        }
+
+        pthread_mutex_init(&shard->lock, NULL);
+        atomic_init(&shard->table, table);
+        str_arena_init(&shard->arena, 0);
+        shard->count = 0;
+    }
+
+    return true;
+}
+
+void str_pool_finalize(StrPool *pool)
+{
+    if (pool && pool->shards) {
+        for (int i = 0; i < STR_INTERN_SHARDS; i++) {
+            struct StrPoolShard *shard = &pool->shards[i];
+            struct StrPoolTable *table = atomic_load_explicit(&shard->table, memory_order_relaxed);
+
+            while (table) {
+                struct StrPoolTable *retired = table->retired;
+                free(table);
+                table = retired;
+            }
+
+            str_arena_finalize(&shard->arena);
+            pthread_mutex_destroy(&shard->lock);
+        }
+
+        free(pool->shards);
+        pool->shards = NULL;
+    }
+}
+
+bool str_pool_intern_str(StrPool *pool, const char *s, int64_t length, StrView *interned)
+{
+    if (length < 0) {
+        length = str_get_len(s);
+    }
+
+    return str_pool_intern_hashed(pool, s, length, str_hash_str(s, length, pool->seed), interned);
+}
+
+bool str_pool_intern(StrPool *pool, Str *str, StrView *interned)
+{
+    const uint64_t hash = pool->seed == atomic_load_explicit(&str_default_hash_seed, memory_order_relaxed)
+        ? str_hash(str)
+        : str_hash_str(str->value, str->length, pool->seed);
+
+    return str_pool_intern_hashed(pool, str->value, str->length, hash, interned);
+}
+
+bool str_pool_lookup_str(const StrPool *pool, const char *s, int64_t length, StrView *interned)
+{
+    if (length < 0) {
+        length = str_get_len(s);
+    }
+
+    const uint64_t hash = str_hash_str(s, length, pool->seed);
+    struct StrPoolShard *shard = str_pool_shard(pool, hash);
+    int64_t slot;
+    struct StrPoolEntry *entry = str_pool_probe(
+        atomic_load_explicit(&shard->table, memory_order_acquire), hash, s, length, &slot
+    );
+
+    if (entry == NULL) {
+        return false;
+    }
+
+    interned->value = entry->value;
+    interned->length = entry->length;
+    return true;
+}
+
+/**
+ * Returns the number of bytes left to read in a regular file, or 0 if it is unknown.
+ */
+static int64_t str_fd_remaining(int fd)
+{
+    struct stat st;
+
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        return 0;
+    }
+
+    const off_t offset = lseek(fd, 0, SEEK_CUR);
+    if (offset < 0 || offset >= st.st_size) {
+        return 0;
+    }
+
+    return (int64_t) (st.st_size - offset);
+}
+
+bool str_append_fd(Str *str, int fd)
+{
+    const int64_t remaining = str_fd_remaining(fd);
+
+    /* A single allocation when the size is known; the loop below still handles files that grow meanwhile */
+    if (!str_ensure_capacity(str, str->length + remaining + 1)) {
+        return false;
+    }
+
+    for (;;) {
+        int64_t available = str->size - str->length - 1;
+
+        if (available == 0) {
+            /* Probe for the end of the file with a small read before growing the buffer */
+            char probe[STR_IO_PROBE_SIZE];
+            ssize_t n = read(fd, probe, sizeof(probe));
+
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+
+            if (n <= 0) {
+                return n == 0;
+            }
+
+            if (!str_append_str(str, probe, n) || !str_ensure_capacity(str, str->length + STR_IO_CHUNK_SIZE + 1)) {
+                return false;
+            }
+
+            continue;
+        }
+
+        ssize_t n = read(fd, STR_TAIL_P(str), (size_t) MIN(available, STR_IO_MAX_TRANSFER));
+
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (n <= 0) {
+            str->value[str->length] = '\0';
+            return n == 0;
+        }
+
+        str->length += n;
+        str->value[str->length] = '\0';
+        str->hash = 0;
+    }
+}
+
+bool str_from_file(Str *str, const char *path)
+{
+    if (!str_init(str)) {
+        return false;
+    }
+
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+    const bool result = fd >= 0 && str_append_fd(str, fd);
+    const int error = errno;
+
+    if (fd >= 0) {
+        close(fd);
+    }
+
+    if (!result) {
+        str_finalize(str);
+        errno = error;
+    }
+
+    return result;
+}
+
+bool str_write_fd(const Str *str, int fd)
+{
+    const char *s = str->value;
+    const char *e = STR_TAIL_P(str);
+
+    while (s < e) {
+        ssize_t n = write(fd, s, (size_t) MIN(e - s, STR_IO_MAX_TRANSFER));
+
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            return false;
+        }
+
+        s += n;
+    }
+
+    return true;
+}
+
+bool str_write_file(const Str *str, const char *path)
+{
+    const int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+
+    if (fd < 0) {
+        return false;
+    }
+
+    bool result = str_write_fd(str, fd);
+    const int error = errno;
+
+    /* close() reports delayed write errors of some file systems */
+    if (close(fd) != 0 && result) {
+        return false;
+    }
+
+    if (!result) {
+        errno = error;
+    }
+
+    return result;
+}
+
+bool str_mapping_init(StrMapping *mapping, const char *path)
+{
+    struct stat st;
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+    mapping->view.value = "";
+    mapping->view.length = 0;
+    mapping->address = NULL;
+    mapping->size = 0;
+
+    if (fd < 0) {
+        return false;
+    }
+
+    if (fstat(fd, &st) != 0) {
+        const int error = errno;
+        close(fd);
+        errno = error;
+        return false;
+    }
+
+    if (st.st_size > 0) {
+        void *address = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        const int error = errno;
+
+        if (address == MAP_FAILED) {
+            close(fd);
+            errno = error;
+            return false;
+        }
+
+        mapping->address = address;
+        mapping->size = (int64_t) st.st_size;
+        mapping->view.value = address;
+        mapping->view.length = mapping->size;
+    }
+
+    /* The mapping stays valid after the descriptor is closed */
+    close(fd);
+    return true;
+}
+
+void str_mapping_finalize(StrMapping *mapping)
+{
+    if (mapping && mapping->address) {
+        munmap(mapping->address, (size_t) mapping->size);
+        mapping->address = NULL;
+        mapping->size = 0;
+        mapping->view.value = "";
+        mapping->view.length = 0;
+    }
+}
+
+bool str_reader_init(StrReader *reader, int fd, int64_t buffer_size, StrReaderOptions options)
+{
+    reader->size = buffer_size > 0 ? buffer_size : STR_READER_DEFAULT_BUFFER_SIZE;
+    reader->buffer = malloc(reader->size);
+    reader->fd = fd;
+    reader->start = 0;
+    reader->end = 0;
+    reader->options = options;
+    reader->eof = false;
+    reader->error = 0;
+
+    return reader->buffer != NULL;
+}
+
+void str_reader_finalize(StrReader *reader)
+{
+    if (reader && reader->buffer) {
+        free(reader->buffer);
+        reader->buffer = NULL;
+        reader->size = 0;
+        reader->start = 0;
+        reader->end = 0;
+    }
+}
+
+/**
+ * Makes room at the end of the buffer and reads once. The unread bytes are moved to the front, and the buffer
+ * doubles if they already fill it. Returns false at the end of the file or on error.
+ */
+static bool str_reader_fill(StrReader *reader)
+{
+    if (reader->start > 0) {
+        memmove(reader->buffer, reader->buffer + reader->start, reader->end - reader->start);
+        reader->end -= reader->start;
+        reader->start = 0;
+    }
+
+    if (reader->end == reader->size) {
+        /* The pending line is longer than the buffer */
+        char *buffer = realloc(reader->buffer, reader->size * 2);
+        if (buffer == NULL) {
+            reader->error = ENOMEM;
+            return false;
+        }
+
+        reader->buffer = buffer;
+        reader->size *= 2;
+    }
+
+    for (;;) {
+        const int64_t available = MIN(reader->size - reader->end, STR_IO_MAX_TRANSFER);
+        const ssize_t n = read(reader->fd, reader->buffer + reader->end, (size_t) available);
+
+        if (n > 0) {
+            reader->end += n;
+            return true;
+        }
+
+        if (n == 0) {
+            reader->eof = true;
+            return false;
+        }
+
+        if (errno != EINTR) {
+            reader->error = errno;
+            return false;
+        }
+    }
+}
+
+bool str_reader_next_line(StrReader *reader, StrView *line)
+{
+    /* Bytes before this offset from the start are known not to contain '\n' */
+    int64_t scanned = 0;
+    const char *newline;
+
+    for (;;) {
+        newline = memchr(reader->buffer + reader->start + scanned, '\n', reader->end - reader->start - scanned);
+        if (newline) {
+            break;
+        }
+
+        scanned = reader->end - reader->start;
+
+        if (reader->eof || reader->error || !str_reader_fill(reader)) {
+            if (reader->error || reader->start == reader->end) {
+                return false;
+            }
+
+            /* The last line does not end with '\n' */
+            newline = reader->buffer + reader->end;
+            break;
+        }
+    }
+
+    const char *s = reader->buffer + reader->start;
+    const char *e = newline;
+    const bool terminated = newline < reader->buffer + reader->end;
+
+    reader->start = newline - reader->buffer + terminated;
+
+    if ((reader->options & STR_READER_STRIP_CR) && terminated && e > s && e[-1] == '\r') {
+        e--;
+    }
+
+    line->value = s;
+    line->length = e - s;
+    return true;
+}
+
+bool str_writer_init(StrWriter *writer, int fd, int64_t flush_size, int max_segments)
+{
+    writer->fd = fd;
+    writer->count = 0;
+    writer->max_segments = max_segments > 0 ? max_segments : STR_WRITER_DEFAULT_MAX_SEGMENTS;
+    writer->staging_used = 0;
+    writer->flush_size = flush_size > 0 ? flush_size : STR_WRITER_DEFAULT_FLUSH_SIZE;
+    writer->pending = 0;
+    writer->error = 0;
+
+#ifdef IOV_MAX
+    writer->max_segments = MIN(writer->max_segments, IOV_MAX);
+#endif
+
+    writer->segments = malloc(sizeof(struct iovec) * writer->max_segments);
+    writer->staging = malloc(writer->flush_size);
+
+    if (!writer->segments || !writer->staging) {
+        str_writer_finalize(writer);
+        return false;
+    }
+
+    return true;
+}
+
+void str_writer_finalize(StrWriter *writer)
+{
+    if (writer) {
+        free(writer->segments);
+        free(writer->staging);
+        writer->segments = NULL;
+        writer->staging = NULL;
+        writer->count = 0;
+        writer->staging_used = 0;
+        writer->pending = 0;
+    }
+}
+
+bool str_writer_flush(StrWriter *writer)
+{
+    struct iovec *segment = writer->segments;
+    struct iovec *end = writer->segments + writer->count;
+
+    while (segment < end && writer->error == 0) {
+        const ssize_t n = writev(writer->fd, segment, (int) (end - segment));
+
+        if (n < 0) {
+            if (errno != EINTR) {
+                writer->error = errno;
+            }
+
+            continue;
+        }
+
+        /* Skip the segments written completely and advance into the first partial one */
+        size_t written = (size_t) n;
+
+        while (segment < end && written >= segment->iov_len) {
+            written -= segment->iov_len;
+            segment++;
+        }
+
+        if (segment < end) {
+            segment->iov_base = (char *) segment->iov_base + written;
+            segment->iov_len -= written;
+        }
+    }
+
+    writer->count = 0;
+    writer->staging_used = 0;
+    writer->pending = 0;
+    return writer->error == 0;
+}
+
+/**
+ * Adds a segment, merging it with the previous one when both are contiguous, as consecutive copies into the
+ * staging buffer are. Flushes when a threshold is reached.
+ */
+static bool str_writer_push(StrWriter *writer, const char *s, int64_t length)
+{
+    struct iovec *last = writer->count > 0 ? &writer->segments[writer->count - 1] : NULL;
+
+    if (last && (const char *) last->iov_base + last->iov_len == s) {
+        last->iov_len += (size_t) length;
+    } else {
+        writer->segments[writer->count].iov_base = (void *) s;
+        writer->segments[writer->count].iov_len = (size_t) length;
+        writer->count++;
+    }
+
+    writer->pending += length;
+
+    if (writer->pending >= writer->flush_size || writer->count == writer->max_segments) {
+        return str_writer_flush(writer);
+    }
+
+    return true;
+}
+
+bool str_writer_write_str(StrWriter *writer, const char *s, int64_t length)
+{
+    if (length < 0) {
+        length = str_get_len(s);
+    }
+
+    if (writer->error) {
+        return false;
+    }
+
+    if (length == 0) {
+        return true;
+    }
+
+    if (writer->staging_used + length > writer->flush_size && !str_writer_flush(writer)) {
+        return false;
+    }
+
+    if (length >= writer->flush_size) {
+        /* Too large to stage: the caller's buffer is written before returning, so it needs no copy */
+        return str_writer_push(writer, s, length) && str_writer_flush(writer);
+    }
+
+    char *copy = writer->staging + writer->staging_used;
+    memcpy(copy, s, length);
+    writer->staging_used += length;
+
+    return str_writer_push(writer, copy, length);
+}
+
+bool str_writer_write_ref_str(StrWriter *writer, const char *s, int64_t length)
+{
+    if (length < 0) {
+        length = str_get_len(s);
+    }
+
+    if (length < STR_WRITER_REF_MIN) {
+        return str_writer_write_str(writer, s, length);
+    }
+
+    if (writer->error) {
+        return false;
+    }
+
+    return str_writer_push(writer, s, length);
+}
+#endif
+
+struct StrRopeChunk
+{
+    struct StrRopeChunk *next;
+    int64_t size;
+    int64_t used;
+};
+
+#define STR_ROPE_HEADER_SIZE STR_ALIGN((int64_t) sizeof(struct StrRopeChunk))
+#define STR_ROPE_CHUNK_DATA(chunk) ((char *) (chunk) + STR_ROPE_HEADER_SIZE)
+
+void str_rope_init(StrRope *rope, int64_t chunk_size)
+{
+    rope->first = NULL;
+    rope->last = NULL;
+    rope->length = 0;
+    rope->chunk_size = chunk_size > 0 ? chunk_size : STR_ROPE_DEFAULT_CHUNK_SIZE;
+}
+
+void str_rope_finalize(StrRope *rope)
+{
+    if (rope) {
+        struct StrRopeChunk *chunk = rope->first;
+
+        while (chunk) {
+            struct StrRopeChunk *next = chunk->next;
+            free(chunk);
+            chunk = next;
+        }
+
+        rope->first = NULL;
+        rope->last = NULL;
+        rope->length = 0;
+    }
+}
+
+bool str_rope_append_str(StrRope *rope, const char *s, int64_t length)
+{
+    if (length < 0) {
+        length = str_get_len(s);
+    }
+
+    while (length > 0) {
+        struct StrRopeChunk *chunk = rope->last;
+
+        if (chunk == NULL || chunk->used == chunk->size) {
+            chunk = malloc(STR_ROPE_HEADER_SIZE + rope->chunk_size);
+            if (chunk == NULL) {
+                return false;
+            }
+
+            chunk->next = NULL;
+            chunk->size = rope->chunk_size;
+            chunk->used = 0;
+
+            if (rope->last) {
+                rope->last->next = chunk;
+            } else {
+                rope->first = chunk;
+            }
+
+            rope->last = chunk;
+        }
+
+        const int64_t n = MIN(length, chunk->size - chunk->used);
+
+        memcpy(STR_ROPE_CHUNK_DATA(chunk) + chunk->used, s, n);
+        chunk->used += n;
+        rope->length += n;
+        s += n;
+        length -= n;
+    }
+
+    return true;
+}
+
+void str_rope_concat(StrRope *rope, StrRope *other)
+{
+    if (other->first == NULL) {
+        return;
+    }
+
+    if (rope->last) {
+        rope->last->next = other->first;
+    } else {
+        rope->first = other->first;
+    }
+
+    rope->last = other->last;
+    rope->length += other->length;
+
+    other->first = NULL;
+    other->last = NULL;
+    other->length = 0;
+}
+
+bool str_rope_flatten(const StrRope *rope, Str *str)
+{
+    if (!str_ensure_capacity(str, str->length + rope->length + 1)) {
+        return false;
+    }
+
+    for (const struct StrRopeChunk *chunk = rope->first; chunk; chunk = chunk->next) {
+        memcpy(STR_TAIL_P(str), STR_ROPE_CHUNK_DATA(chunk), chunk->used);
+        str->length += chunk->used;
+    }
+
+    str->value[str->length] = '\0';
+    str->hash = 0;
+    return true;
+}
+
+#ifdef STR_HAVE_POSIX
+bool str_rope_write_fd(const StrRope *rope, int fd)
+{
+    struct iovec segments[STR_ROPE_WRITE_SEGMENTS];
+    const struct StrRopeChunk *chunk = rope->first;
+    int64_t offset = 0;
+
+    while (chunk) {
+        /* Gather the next batch of chunks, starting at the unwritten part of the current one */
+        const struct StrRopeChunk *next = chunk;
+        int64_t next_offset = offset;
+        int count = 0;
+
+        while (next && count < STR_ROPE_WRITE_SEGMENTS) {
+            if (next->used > next_offset) {
+                segments[count].iov_base = STR_ROPE_CHUNK_DATA(next) + next_offset;
+                segments[count].iov_len = (size_t) (next->used - next_offset);
+                count++;
+            }
+
+            next = next->next;
+            next_offset = 0;
+        }
+
+        if (count == 0) {
+            break;
+        }
+
+        const ssize_t n = writev(fd, segments, count);
+
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            return false;
+        }
+
+        /* Skip the chunks written completely and advance into the first partial one */
+        int64_t written = n;
+
+        while (chunk && written >= chunk->used - offset) {
+            written -= chunk->used - offset;
+            chunk = chunk->next;
+            offset = 0;
+        }
+
+        offset += written;
+    }
+
+    return true;
+}
+
+bool str_writer_write_rope(StrWriter *writer, const StrRope *rope)
+{
+    for (const struct StrRopeChunk *chunk = rope->first; chunk; chunk = chunk->next) {
+        if (chunk->used > 0 && !str_writer_write_ref_str(writer, STR_ROPE_CHUNK_DATA(chunk), chunk->used)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+#endif
+
+#ifdef STR_STATS
+static pthread_mutex_t str_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t str_stats_once = PTHREAD_ONCE_INIT;
+static pthread_key_t str_stats_key;
+static struct StrStatsSlot *str_stats_slots = NULL;
+
+/* The counters of the threads that have exited */
+static int64_t str_stats_retired[STR_STAT_COUNT];
+
+/**
+ * Folds the counters of an exiting thread into the retired totals and releases its slot.
+ */
+static void str_stats_retire(void *context)
+{
+    struct StrStatsSlot *slot = context;
+
+    pthread_mutex_lock(&str_stats_lock);
+
+    for (int i = 0; i < STR_STAT_COUNT; i++) {
+        str_stats_retired[i] += atomic_load_explicit(&slot->counters[i], memory_order_relaxed);
+    }
+
+    if (slot->previous) {
+        slot->previous->next = slot->next;
+    } else {
+        str_stats_slots = slot->next;
+    }
+
+    if (slot->next) {
+        slot->next->previous = slot->previous;
+    }
+
+    pthread_mutex_unlock(&str_stats_lock);
+
+    /*
+     * Runs on the exiting thread. A later destructor that still counts registers a new slot, which the key
+     * retires again on its next destructor pass.
+     */
+    str_stats_slot = NULL;
+    free(slot);
+}
+
+static void str_stats_create_key(void)
+{
+    pthread_key_create(&str_stats_key, str_stats_retire);
+}
+
+/**
+ * Allocates the slot of the calling thread on its first counted event. Returns NULL if it cannot be allocated, in
+ * which case the events of the thread are not counted.
+ */
+static struct StrStatsSlot *str_stats_register(void)
+{
+    pthread_once(&str_stats_once, str_stats_create_key);
+
+    struct StrStatsSlot *slot = malloc(sizeof(struct StrStatsSlot));
+    if (slot == NULL) {
+        return NULL;
+    }
+
+    for (int i = 0; i < STR_STAT_COUNT; i++) {
+        atomic_init(&slot->counters[i], 0);
+    }
+
+    pthread_mutex_lock(&str_stats_lock);
+    slot->previous = NULL;
+    slot->next = str_stats_slots;
+
+    if (str_stats_slots) {
+        str_stats_slots->previous = slot;
+    }
+
+    str_stats_slots = slot;
+    pthread_mutex_unlock(&str_stats_lock);
+
+    pthread_setspecific(str_stats_key, slot);
+    str_stats_slot = slot;
+    return slot;
+}
+#endif
+
+bool str_stats_snapshot(StrStats *stats)
+{
+    int64_t counters[STR_STAT_COUNT] = {0};
+    bool enabled = false;
+
+#ifdef STR_STATS
+    pthread_mutex_lock(&str_stats_lock);
+
+    for (int i = 0; i < STR_STAT_COUNT; i++) {
+        counters[i] = str_stats_retired[i];
+    }
+
+    for (struct StrStatsSlot *slot = str_stats_slots; slot; slot = slot->next) {
+        for (int i = 0; i < STR_STAT_COUNT; i++) {
+            counters[i] += atomic_load_explicit(&slot->counters[i], memory_order_relaxed);
+        }
+    }
+
+    pthread_mutex_unlock(&str_stats_lock);
+    enabled = true;
+#endif
+
+    stats->reallocations = counters[STR_STAT_REALLOCATIONS];
+    stats->growths = counters[STR_STAT_GROWTHS];
+    stats->appended_bytes = counters[STR_STAT_APPENDED_BYTES];
+    stats->repeated_bytes = counters[STR_STAT_REPEATED_BYTES];
+    stats->trimmed_bytes = counters[STR_STAT_TRIMMED_BYTES];
+    stats->searches = counters[STR_STAT_SEARCHES];
+    stats->searched_bytes = counters[STR_STAT_SEARCHED_BYTES];
+    memcpy(stats->sizes, counters + STR_STAT_SIZES, sizeof(stats->sizes));
+    return enabled;
+}
+
+bool str_stats_dump(const StrStats *stats, Str *str)
+{
+    bool result = str_append_format(str, "reallocations: %lld\n", (long long) stats->reallocations)
+        && str_append_format(str, "growths: %lld\n", (long long) stats->growths)
+        && str_append_format(str, "appended_bytes: %lld\n", (long long) stats->appended_bytes)
+        && str_append_format(str, "repeated_bytes: %lld\n", (long long) stats->repeated_bytes)
+        && str_append_format(str, "trimmed_bytes: %lld\n", (long long) stats->trimmed_bytes)
+        && str_append_format(str, "searches: %lld\n", (long long) stats->searches)
+        && str_append_format(str, "searched_bytes: %lld\n", (long long) stats->searched_bytes);
+
+    for (int i = 0; i < STR_STATS_SIZE_BUCKETS && result; i++) {
+        if (stats->sizes[i] != 0) {
+            result = str_append_format(str, "sizes[%llu-%llu]: %lld\n", 1ULL << i, (2ULL << i) - 1, (long long) stats->sizes[i]);
+        }
+    }
+
+    return result;
+}
\ No newline at end of file
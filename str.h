@@ -1,17 +1,210 @@
 #pragma once
 
+#include <stdarg.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #define STR_DEFAULT_INIT_SIZE 16
+#define STR_INLINE_SIZE 24
+#define STR_ARENA_DEFAULT_CHUNK_SIZE 65536
+#define STR_POOL_CLASSES 9
+#define STR_READER_DEFAULT_BUFFER_SIZE 65536
+#define STR_WRITER_DEFAULT_FLUSH_SIZE 65536
+#define STR_WRITER_DEFAULT_MAX_SEGMENTS 64
+#define STR_ROPE_DEFAULT_CHUNK_SIZE 65536
+#define STR_STATS_SIZE_BUCKETS 64
 
+/*
+ * The string interner, the file and descriptor I/O, the reader, the writer, the descriptor output of ropes and the
+ * mmap allocator need POSIX. They are compiled on POSIX systems unless STR_NO_POSIX is defined; the rest of the
+ * library only needs ISO C11.
+ */
+#if !defined(STR_NO_POSIX) && (defined(__unix__) || defined(__APPLE__))
+#define STR_HAVE_POSIX 1
+#endif
+
+/**
+ * A memory allocator used by Str objects. Every function receives the context pointer of the allocator.
+ * Sizes are always passed back to reallocate() and release(), so allocators do not need to track them.
+ */
+typedef struct StrAllocator
+{
+    void *(*allocate)(void *context, int64_t size);
+    void *(*reallocate)(void *context, void *ptr, int64_t old_size, int64_t new_size);
+    void (*release)(void *context, void *ptr, int64_t size);
+    void *context;
+} StrAllocator;
+
+/**
+ * Strings whose size fits in STR_INLINE_SIZE are stored in the inline buffer of the object itself and
+ * no memory is allocated until the string grows past it. Because the value may point inside the object,
+ * a Str object must never be copied by assignment or memcpy(); use str_copy() instead.
+ *
+ * The hash field caches the result of str_hash() and is 0 while it is unknown. Every function of the library that
+ * modifies the value resets it; code that writes to the value directly must set it to 0 as well.
+ *
+ * Str objects that use str_shared_allocator may share their buffer with copies made by str_copy(). Every function
+ * of the library that modifies the value first calls str_detach(); code that writes to the value directly must
+ * call it as well.
+ */
 typedef struct Str
 {
     char *value;
     int64_t size;
     int64_t length;
+    const StrAllocator *allocator;
+    uint64_t hash;
+    char inline_value[STR_INLINE_SIZE];
 } Str;
 
+/**
+ * A non-owning view of a string: a pointer and a length. Views are passed by value and never allocate;
+ * the viewed memory must outlive the view.
+ */
+typedef struct StrView
+{
+    const char *value;
+    int64_t length;
+} StrView;
+
+/**
+ * A bump allocator. Allocations are carved from large chunks, releasing memory is a no-op (except for the most
+ * recent allocation) and str_arena_reset() releases everything at once. Not thread-safe.
+ * Pass &arena.allocator to str_init_allocator().
+ */
+typedef struct StrArena
+{
+    StrAllocator allocator;
+    struct StrArenaChunk *first;
+    struct StrArenaChunk *current;
+    void *last;
+    int64_t chunk_size;
+} StrArena;
+
+/**
+ * A size-class allocator. Blocks of up to 4096 bytes are rounded to a power of two and recycled through
+ * per-class free lists; larger blocks are forwarded to malloc(). Not thread-safe.
+ * Pass &pool.allocator to str_init_allocator().
+ */
+typedef struct StrPoolAllocator
+{
+    StrAllocator allocator;
+    StrArena arena;
+    void *free_lists[STR_POOL_CLASSES];
+} StrPoolAllocator;
+
+#ifdef STR_HAVE_POSIX
+/**
+ * A thread-safe string interner. Each distinct value is stored once and interning returns a view of that copy,
+ * so two interned views are equal if and only if their value pointers are equal. The copies are NUL-terminated
+ * and stay valid until the pool is finalized. Lookups take no locks; inserts lock one of the shards of the pool.
+ */
+typedef struct StrPool
+{
+    struct StrPoolShard *shards;
+    uint64_t seed;
+} StrPool;
+
+/**
+ * A read-only memory mapping of a whole file, exposed as a view. The view is not NUL-terminated.
+ */
+typedef struct StrMapping
+{
+    StrView view;
+    void *address;
+    int64_t size;
+} StrMapping;
+
+typedef enum StrReaderOptions
+{
+    STR_READER_NONE = 0,
+    STR_READER_STRIP_CR = 1,
+} StrReaderOptions;
+
+/**
+ * A buffered line reader over a file descriptor. Lines are returned as views into the buffer of the reader, so
+ * reading a line neither allocates nor copies unless the line is longer than the buffer.
+ */
+typedef struct StrReader
+{
+    int fd;
+    char *buffer;
+    int64_t size;
+    int64_t start;
+    int64_t end;
+    StrReaderOptions options;
+    bool eof;
+    int error;
+} StrReader;
+
+/**
+ * A batched output sink over a file descriptor. Written strings are either copied into a staging buffer or
+ * referenced in place, and everything pending is sent with a single writev() call when the byte or the segment
+ * threshold is reached, or when str_writer_flush() is called.
+ */
+typedef struct StrWriter
+{
+    int fd;
+    struct iovec *segments;
+    int count;
+    int max_segments;
+    char *staging;
+    int64_t staging_used;
+    int64_t flush_size;
+    int64_t pending;
+    int error;
+} StrWriter;
+#endif
+
+/**
+ * A chunked string builder. Appended bytes are copied into a list of fixed-size chunks, so growing never moves
+ * the bytes already written and concatenating another rope only links its chunks. The content is flattened into a
+ * Str on demand, or sent to a file descriptor straight from the chunks. Not thread-safe.
+ */
+typedef struct StrRope
+{
+    struct StrRopeChunk *first;
+    struct StrRopeChunk *last;
+    int64_t length;
+    int64_t chunk_size;
+} StrRope;
+
+/**
+ * How str_ensure_capacity() grows a Str object that is too small. The result is never smaller than the required
+ * size. STR_GROWTH_PAGE doubles small buffers and grows buffers of 1 MiB or more by half, rounded up to whole
+ * pages, which suits str_mmap_allocator.
+ */
+typedef enum StrGrowthPolicy
+{
+    STR_GROWTH_DOUBLE = 0,
+    STR_GROWTH_ONE_AND_HALF = 1,
+    STR_GROWTH_PAGE = 2,
+} StrGrowthPolicy;
+
+/**
+ * Counters of the work done by the library, aggregated over every thread. They are only collected when str.c is
+ * compiled with STR_STATS defined; otherwise counting costs nothing and every counter stays 0.
+ */
+typedef struct StrStats
+{
+    /* Calls to str_set_size() that allocated or resized a heap buffer */
+    int64_t reallocations;
+    /* Calls to str_ensure_capacity() that had to grow the buffer */
+    int64_t growths;
+    /* Bytes copied by str_append_str(), str_append_char(), str_join() and the formatting functions */
+    int64_t appended_bytes;
+    /* Bytes written by str_repeat() */
+    int64_t repeated_bytes;
+    /* Bytes moved to the front by the trim functions */
+    int64_t trimmed_bytes;
+    /* Substring searches, and the haystack bytes they were given */
+    int64_t searches;
+    int64_t searched_bytes;
+    /* Heap buffer sizes: element i counts the buffers allocated with a size in [2^i, 2^(i+1)) */
+    int64_t sizes[STR_STATS_SIZE_BUCKETS];
+} StrStats;
+
 typedef enum StrTrimOptions
 {
     STR_TRIM_NONE = 0,
@@ -20,8 +213,118 @@ typedef enum StrTrimOptions
     STR_TRIM_BOTH = 3,
 } StrTrimOptions;
 
+/**
+ * A set of bytes compiled into a lookup bitmap. Sets of up to 16 bytes are also kept as a list to be scanned with
+ * vector instructions.
+ */
+typedef struct StrCharSet
+{
+    uint64_t bitmap[4];
+    char chars[16];
+    int count;
+} StrCharSet;
+
+typedef enum StrIntFormat
+{
+    STR_INT_DECIMAL = 0,
+    STR_INT_HEX = 1,
+    STR_INT_HEX_UPPER = 2,
+    STR_INT_OCTAL = 3,
+    STR_INT_BINARY = 4,
+} StrIntFormat;
+
+typedef enum StrPadOptions
+{
+    STR_PAD_SPACE = 0,
+    STR_PAD_ZERO = 1,
+} StrPadOptions;
+
+typedef enum StrParseResult
+{
+    STR_PARSE_OK = 0,
+    STR_PARSE_INVALID = 1,
+    STR_PARSE_OVERFLOW = 2,
+} StrParseResult;
+
+/**
+ * A format string parsed once to be applied many times with str_append_format_compiled().
+ */
+typedef struct StrFormat
+{
+    struct StrFormatSegment *segments;
+    char *text;
+    int count;
+} StrFormat;
+
+typedef enum StrSplitOptions
+{
+    STR_SPLIT_NONE = 0,
+    STR_SPLIT_SKIP_EMPTY = 1,
+} StrSplitOptions;
+
+/**
+ * An iterator over the fields of a string separated by any of a set of delimiter bytes.
+ * The fields are views of the source string; nothing is copied.
+ */
+typedef struct StrSplit
+{
+    StrView rest;
+    StrCharSet delimiters;
+    int64_t limit;
+    StrSplitOptions options;
+    bool done;
+} StrSplit;
+
+typedef enum StrSearchAlgorithm
+{
+    STR_SEARCH_BYTE = 0,
+    STR_SEARCH_VECTOR = 1,
+    STR_SEARCH_RAITA = 2,
+    STR_SEARCH_TWO_WAY = 3,
+} StrSearchAlgorithm;
+
+/**
+ * A needle preprocessed once to be searched in many haystacks.
+ * The algorithm is chosen from the length of the needle: a byte scan for single bytes, the vectorized kernel
+ * of str_indexof_str() for short needles, Raita (Boyer-Moore-Horspool) for medium needles and Two-Way for long
+ * needles, which guarantees a linear worst case.
+ */
+typedef struct StrSearcher
+{
+    char *needle;
+    int64_t length;
+    StrSearchAlgorithm algorithm;
+    int64_t critical;
+    int64_t period;
+    int64_t memory;
+    int64_t shift[256];
+    int64_t reverse_shift[256];
+} StrSearcher;
+
+/**
+ * A match reported by StrMatcher.
+ */
+typedef struct StrMatch
+{
+    int64_t index;
+    int64_t length;
+    int pattern;
+} StrMatch;
+
+/**
+ * A set of patterns compiled to be searched in a single pass.
+ * Small sets use a vectorized Teddy-style prefilter when the CPU supports SSSE3; otherwise an Aho-Corasick
+ * automaton is used.
+ */
+typedef struct StrMatcher
+{
+    struct StrMatcherData *data;
+    int count;
+} StrMatcher;
+
 /**
  * Initializes a Str object of the given size.
+ * If the size fits in the inline buffer (STR_INLINE_SIZE), no memory is allocated.
  *
  * @param str A handle to the Str object to initialize.
  * @param size The size (in bytes) to allocate.
@@ -30,6 +333,18 @@ typedef enum StrTrimOptions
  */
 bool str_init_size(Str *str, int64_t size);
 
+/**
+ * Initializes a Str object of the given size that gets its memory from the given allocator.
+ * The allocator must outlive the Str object.
+ *
+ * @param str A handle to the Str object to initialize.
+ * @param size The size (in bytes) to allocate.
+ * @param allocator A handle to the allocator. Pass NULL to use malloc().
+ *
+ * @return True if the Str object was initialized; otherwise false.
+ */
+bool str_init_allocator(Str *str, int64_t size, const StrAllocator *allocator);
+
 /**
  * Quick initializes a Str object of the given size
  *
@@ -74,7 +389,8 @@ bool str_set_length(Str *str, int64_t length);
 
 /**
  * Tests that the allocated memory is large enough to meet the given size.
- * If it is not, then it is reallocated to twice its original size.
+ * If it is not, then it is reallocated according to the growth policy set by str_set_growth_policy(). Without an
+ * allocator, the size is then raised to what malloc() actually reserved, where the C library reports it.
  *
  * @param str A handle to the Str object.
  * @param min_size The minimum required size.
@@ -84,7 +400,38 @@ bool str_set_length(Str *str, int64_t length);
 bool str_ensure_capacity(Str *str, int64_t min_size);
 
 /**
- * Copies the Str object into an uninitialized Str object.
+ * Sets the growth policy used by str_ensure_capacity() for every Str object. It should be set at startup, before
+ * other threads use the library.
+ *
+ * @param policy The new policy. The default policy is STR_GROWTH_DOUBLE.
+ */
+void str_set_growth_policy(StrGrowthPolicy policy);
+
+/**
+ * Releases the memory that is not needed to hold the current value. Values that fit in the inline buffer are
+ * moved back to it and their heap memory is released.
+ *
+ * @param str A handle to the Str object.
+ *
+ * @return True if the memory was reallocated correctly or already fit; otherwise false and the Str object is
+ * unchanged.
+ */
+bool str_shrink_to_fit(Str *str);
+
+/**
+ * Gives the Str object a private buffer if its buffer is shared with other Str objects (see str_shared_allocator).
+ * Functions of the library that modify the value call it already; it is only needed before writing to the value
+ * directly. Functions that do not return a status leave the value unchanged if the copy cannot be allocated.
+ *
+ * @param str A handle to the Str object.
+ *
+ * @return True if the buffer is private or was copied successfully; otherwise false.
+ */
+bool str_detach(Str *str);
+
+/**
+ * Copies the Str object into an uninitialized Str object. The copy uses the allocator of the source.
+ * With str_shared_allocator, the buffer is shared in constant time instead of copied.
  *
  * @param source A handle to the source Str object.
  * @param destination A handle to the uninitialized Str object. This object must not be initialized,
@@ -164,9 +511,90 @@ static inline int64_t str_indexof(const Str *str, const Str *substr)
  */
 static inline bool str_equals(const Str *a, const Str *b)
 {
+    if (a->hash != 0 && b->hash != 0 && a->hash != b->hash) {
+        /* Different hashes cannot have equal values */
+        return false;
+    }
+
     return str_equals_str(a, b->value, b->length);
 }
 
+/**
+ * Compares a Str object and a string ignoring the case of ASCII letters.
+ *
+ * @param str A handle to the Str object.
+ * @param s A pointer to the string.
+ * @param length The length of the string. Pass a negative value to calculate the length internally.
+ *
+ * @return -1 if the Str object is less than the string.
+ * 0 if the value of the Str object is equal to the string.
+ * 1 if the Str object is greater than the string.
+ */
+int str_compare_ci_str(const Str *str, const char *s, int64_t length);
+
+/**
+ * Compares the value of two Str objects ignoring the case of ASCII letters.
+ *
+ * @param a A handle to the first Str object.
+ * @param b A handle to the second Str object.
+ *
+ * @return -1 if the first Str object is less than the second Str object.
+ * 0 if both Str objects are equal.
+ * 1 if the first Str object is greater than the second Str object.
+ */
+static inline int str_compare_ci(const Str *a, const Str *b)
+{
+    return str_compare_ci_str(a, b->value, b->length);
+}
+
+/**
+ * Returns true if the value of the Str object is equal to the given string ignoring the case of ASCII letters.
+ *
+ * @param str A handle to the Str object.
+ * @param s A pointer to the string.
+ * @param length The length of the string. Pass a negative value to calculate the length internally.
+ *
+ * @return True if the value of the Str object is equal to the string; otherwise false.
+ */
+bool str_equals_ci_str(const Str *str, const char *s, int64_t length);
+
+/**
+ * Returns true if both Str objects are equal ignoring the case of ASCII letters.
+ *
+ * @param a A handle to the first Str object.
+ * @param b A handle to the second Str object.
+ *
+ * @return True if both objects contain the same value; otherwise false.
+ */
+static inline bool str_equals_ci(const Str *a, const Str *b)
+{
+    return str_equals_ci_str(a, b->value, b->length);
+}
+
+/**
+ * Returns the zero-based index of the first occurrence of the needle ignoring the case of ASCII letters.
+ *
+ * @param str A handle to the Str object.
+ * @param substr A pointer to the string to search.
+ * @param length The length of the string. Pass a negative value to calculate the length internally.
+ *
+ * @return The zero-based index of the first occurrence or -1 if the needle is not present.
+ */
+int64_t str_indexof_ci_str(const Str *str, const char *substr, int64_t length);
+
+/**
+ * Returns the zero-based index of the first occurrence of the needle ignoring the case of ASCII letters.
+ *
+ * @param str A handle to the Str object.
+ * @param substr A handle to the Str object to search.
+ *
+ * @return The zero-based index of the first occurrence or -1 if the needle is not present.
+ */
+static inline int64_t str_indexof_ci(const Str *str, const Str *substr)
+{
+    return str_indexof_ci_str(str, substr->value, substr->length);
+}
+
 /**
  * Returns true if the Str object contains the given substring.
  *
@@ -272,6 +700,50 @@ bool str_append_str(Str *str, const char *s, int64_t len);
  */
 bool str_append_format(Str *str, const char *format, ...);
 
+/**
+ * Appends a formatted string using a va_list. (Like vprintf).
+ * The output is written straight into the spare capacity; the string only grows (and the output is formatted
+ * a second time) when it does not fit.
+ *
+ * @param str A handle to the Str object.
+ * @param format The format string.
+ * @param args The arguments for the format string.
+ *
+ * @return True if the formatted string was appended successfully; otherwise false.
+ */
+bool str_append_vformat(Str *str, const char *format, va_list args);
+
+/**
+ * Parses a printf() format string into a StrFormat object.
+ * Integer (with zero padding and width), string, char and %f conversions are formatted natively; other
+ * conversions are forwarded to vsnprintf() one at a time. The %n conversion is not supported.
+ *
+ * @param format A handle to the StrFormat object to initialize.
+ * @param pattern The format string.
+ *
+ * @return True if the StrFormat object was initialized; otherwise false.
+ */
+bool str_format_init(StrFormat *format, const char *pattern);
+
+/**
+ * Finalizes the StrFormat handle and memory resources are deallocated.
+ * This function is NULL-safe. The function does nothing if NULL is passed as argument.
+ *
+ * @param format A handle to the StrFormat object to finalize.
+ */
+void str_format_finalize(StrFormat *format);
+
+/**
+ * Appends a string formatted with a format parsed by str_format_init().
+ *
+ * @param str A handle to the Str object.
+ * @param format A handle to the StrFormat object.
+ * @param ... A vararg list of arguments for the format.
+ *
+ * @return True if the formatted string was appended successfully; otherwise false. Nothing is appended on failure.
+ */
+bool str_append_format_compiled(Str *str, const StrFormat *format, ...);
+
 /**
  * Appends a signed 64-bit integer.
  *
@@ -292,8 +764,36 @@ bool str_append_int(Str *str, int64_t value);
  */
 bool str_append_uint(Str *str, uint64_t value);
 
+/**
+ * Appends a signed 64-bit integer in the given base, padded to a minimum width.
+ * Negative values are written as a minus sign followed by the magnitude (e.g. -ff).
+ *
+ * @param str A handle to the Str object.
+ * @param value The value to append.
+ * @param format The base of the digits.
+ * @param width The minimum number of characters to append, sign included. Pass 0 for no padding.
+ * @param pad The padding: spaces before the sign or zeros after the sign.
+ *
+ * @return True if the integer was appended successfully; otherwise false.
+ */
+bool str_append_int_format(Str *str, int64_t value, StrIntFormat format, int width, StrPadOptions pad);
+
+/**
+ * Appends an unsigned 64-bit integer in the given base, padded to a minimum width.
+ *
+ * @param str A handle to the Str object.
+ * @param value The value to append.
+ * @param format The base of the digits.
+ * @param width The minimum number of characters to append. Pass 0 for no padding.
+ * @param pad The padding: spaces or zeros before the digits.
+ *
+ * @return True if the integer was appended successfully; otherwise false.
+ */
+bool str_append_uint_format(Str *str, uint64_t value, StrIntFormat format, int width, StrPadOptions pad);
+
 /**
  * Appends a double precision floating point (AKA double) value.
+ * The output is the same as printf("%.*f", precision, value).
  *
  * @param str A handle to the Str object.
  * @param value The value to append.
@@ -303,6 +803,21 @@ bool str_append_uint(Str *str, uint64_t value);
  */
 bool str_append_float(Str *str, double value, int precision);
 
+/**
+ * Appends the shortest representation of a double that parses back to exactly the same value; among several
+ * candidates of that length the closest to the value is chosen. The digits are generated with the Grisu3 algorithm,
+ * with an exact but slower fallback for the roughly 1% of values it cannot decide. The output follows the JavaScript
+ * number format: decimal notation for exponents in [-6, 21) (e.g. 0.1, 1.5, 100) and exponential notation
+ * otherwise (e.g. 1e+21, 5e-324).
+ * Non-finite values are written as "nan", "inf" and "-inf".
+ *
+ * @param str A handle to the Str object.
+ * @param value The value to append.
+ *
+ * @return True if the value was appended successfully; otherwise false.
+ */
+bool str_append_float_shortest(Str *str, double value);
+
 /**
  * Concatenates the value of another Str object.
  *
@@ -317,27 +832,47 @@ static inline bool str_concat(Str *str, const Str *other)
 }
 
 /**
- * Converts the value of the Str object to uppercase.
+ * Converts the ASCII letters of the Str object to lowercase. Other bytes are left unchanged.
  *
  * @param str A handle to the Str object.
  */
-void str_to_lower(const Str *str);
+void str_to_lower(Str *str);
 
 /**
- * Converts the value of the Str object to lowercase.
+ * Converts the ASCII letters of the Str object to uppercase. Other bytes are left unchanged.
  *
  * @param str A handle to the Str object.
  */
-void str_to_upper(const Str *str);
+void str_to_upper(Str *str);
 
 /**
- * Strips whitespace from the beginning and the end of the Str object.
+ * Strips whitespace (space, '\t', '\n', '\v', '\f' and '\r') from the beginning and the end of the Str object.
  *
  * @param str A handle to the Str object.
  * @param options Trim options.
  */
 void str_trim(Str *str, StrTrimOptions options);
 
+/**
+ * Strips the bytes of the set from the beginning and the end of the Str object.
+ *
+ * @param str A handle to the Str object.
+ * @param set A handle to the compiled set of bytes to strip.
+ * @param options Trim options.
+ */
+void str_trim_charset(Str *str, const StrCharSet *set, StrTrimOptions options);
+
+/**
+ * Strips the given bytes from the beginning and the end of the Str object. To trim many strings with the same
+ * bytes, compile them once with str_charset_init() and use str_trim_charset().
+ *
+ * @param str A handle to the Str object.
+ * @param chars A pointer to the bytes to strip.
+ * @param length The number of bytes. Pass a negative value to calculate the length internally.
+ * @param options Trim options.
+ */
+void str_trim_chars(Str *str, const char *chars, int64_t length, StrTrimOptions options);
+
 /**
  * Repeats the string n times.
  *
@@ -348,3 +883,1003 @@ void str_trim(Str *str, StrTrimOptions options);
  * @return True if the string was repeated; otherwise false.
  */
 bool str_repeat(Str *str, int multiply);
+
+/**
+ * Replaces the first occurrences of a string. Occurrences are found from left to right and do not overlap.
+ * The string is modified in place without allocating when the replacement is not longer than the searched string;
+ * otherwise the buffer grows at most once, to the exact final size.
+ *
+ * @param str A handle to the Str object.
+ * @param search A pointer to the string to replace. An empty string is never replaced.
+ * @param search_length The length of the string to replace. Pass a negative value to calculate it internally.
+ * @param replacement A pointer to the replacement.
+ * @param replacement_length The length of the replacement. Pass a negative value to calculate it internally.
+ * @param limit The maximum number of occurrences to replace. Pass a negative value to replace all of them.
+ *
+ * @return The number of replaced occurrences, or -1 if the buffer could not grow, in which case the string is
+ * unchanged.
+ */
+int64_t str_replace_str(Str *str, const char *search, int64_t search_length, const char *replacement, int64_t replacement_length, int64_t limit);
+
+/**
+ * Replaces every occurrence of a string. See str_replace_str().
+ *
+ * @param str A handle to the Str object.
+ * @param search A pointer to the string to replace. An empty string is never replaced.
+ * @param search_length The length of the string to replace. Pass a negative value to calculate it internally.
+ * @param replacement A pointer to the replacement.
+ * @param replacement_length The length of the replacement. Pass a negative value to calculate it internally.
+ *
+ * @return The number of replaced occurrences, or -1 if the buffer could not grow.
+ */
+static inline int64_t str_replace_all_str(Str *str, const char *search, int64_t search_length, const char *replacement, int64_t replacement_length)
+{
+    return str_replace_str(str, search, search_length, replacement, replacement_length, -1);
+}
+
+/**
+ * Replaces the first occurrences of the value of a Str object. See str_replace_str().
+ *
+ * @param str A handle to the Str object.
+ * @param search A handle to the Str object to replace.
+ * @param replacement A handle to the replacement Str object.
+ * @param limit The maximum number of occurrences to replace. Pass a negative value to replace all of them.
+ *
+ * @return The number of replaced occurrences, or -1 if the buffer could not grow.
+ */
+static inline int64_t str_replace(Str *str, const Str *search, const Str *replacement, int64_t limit)
+{
+    return str_replace_str(str, search->value, search->length, replacement->value, replacement->length, limit);
+}
+
+/**
+ * Replaces every occurrence of the value of a Str object. See str_replace_str().
+ *
+ * @param str A handle to the Str object.
+ * @param search A handle to the Str object to replace.
+ * @param replacement A handle to the replacement Str object.
+ *
+ * @return The number of replaced occurrences, or -1 if the buffer could not grow.
+ */
+static inline int64_t str_replace_all(Str *str, const Str *search, const Str *replacement)
+{
+    return str_replace_str(str, search->value, search->length, replacement->value, replacement->length, -1);
+}
+
+
+/**
+ * Initializes a StrSearcher object for the given needle. The needle is copied.
+ *
+ * @param searcher A handle to the StrSearcher object to initialize.
+ * @param needle A pointer to the string to search.
+ * @param length The length of the needle. Pass a negative value to calculate the length internally.
+ *
+ * @return True if the StrSearcher object was initialized; otherwise false. Empty needles are rejected.
+ */
+bool str_searcher_init_str(StrSearcher *searcher, const char *needle, int64_t length);
+
+/**
+ * Initializes a StrSearcher object for the given needle. The needle is copied.
+ *
+ * @param searcher A handle to the StrSearcher object to initialize.
+ * @param needle A handle to the Str object to search.
+ *
+ * @return True if the StrSearcher object was initialized; otherwise false. Empty needles are rejected.
+ */
+static inline bool str_searcher_init(StrSearcher *searcher, const Str *needle)
+{
+    return str_searcher_init_str(searcher, needle->value, needle->length);
+}
+
+/**
+ * Finalizes the StrSearcher handle and memory resources are deallocated.
+ * This function is NULL-safe. The function does nothing if NULL is passed as argument.
+ *
+ * @param searcher A handle to the StrSearcher object to finalize.
+ */
+void str_searcher_finalize(StrSearcher *searcher);
+
+/**
+ * Returns the zero-based index of the first occurrence of the needle in the given string.
+ *
+ * @param searcher A handle to the StrSearcher object.
+ * @param s A pointer to the string to search in.
+ * @param length The length of the string. Pass a negative value to calculate the length internally.
+ *
+ * @return The zero-based index of the first occurrence or -1 if the needle is not present.
+ */
+int64_t str_searcher_indexof_str(const StrSearcher *searcher, const char *s, int64_t length);
+
+/**
+ * Returns the zero-based index of the first occurrence of the needle in the Str object.
+ *
+ * @param searcher A handle to the StrSearcher object.
+ * @param str A handle to the Str object to search in.
+ *
+ * @return The zero-based index of the first occurrence or -1 if the needle is not present.
+ */
+static inline int64_t str_searcher_indexof(const StrSearcher *searcher, const Str *str)
+{
+    return str_searcher_indexof_str(searcher, str->value, str->length);
+}
+
+/**
+ * Returns the zero-based index of the last occurrence of the needle in the given string.
+ *
+ * @param searcher A handle to the StrSearcher object.
+ * @param s A pointer to the string to search in.
+ * @param length The length of the string. Pass a negative value to calculate the length internally.
+ *
+ * @return The zero-based index of the last occurrence or -1 if the needle is not present.
+ */
+int64_t str_searcher_last_indexof_str(const StrSearcher *searcher, const char *s, int64_t length);
+
+/**
+ * Returns the zero-based index of the last occurrence of the needle in the Str object.
+ *
+ * @param searcher A handle to the StrSearcher object.
+ * @param str A handle to the Str object to search in.
+ *
+ * @return The zero-based index of the last occurrence or -1 if the needle is not present.
+ */
+static inline int64_t str_searcher_last_indexof(const StrSearcher *searcher, const Str *str)
+{
+    return str_searcher_last_indexof_str(searcher, str->value, str->length);
+}
+
+/**
+ * Finds the non-overlapping occurrences of the needle in the given string, from left to right.
+ *
+ * @param searcher A handle to the StrSearcher object.
+ * @param s A pointer to the string to search in.
+ * @param length The length of the string. Pass a negative value to calculate the length internally.
+ * @param indexes An array that receives the zero-based index of each occurrence. May be NULL if max is 0.
+ * @param max The capacity of the indexes array. Occurrences past this number are counted but not stored.
+ *
+ * @return The total number of occurrences.
+ */
+int64_t str_searcher_find_all_str(const StrSearcher *searcher, const char *s, int64_t length, int64_t *indexes, int64_t max);
+
+/**
+ * Finds the non-overlapping occurrences of the needle in the Str object, from left to right.
+ *
+ * @param searcher A handle to the StrSearcher object.
+ * @param str A handle to the Str object to search in.
+ * @param indexes An array that receives the zero-based index of each occurrence. May be NULL if max is 0.
+ * @param max The capacity of the indexes array. Occurrences past this number are counted but not stored.
+ *
+ * @return The total number of occurrences.
+ */
+static inline int64_t str_searcher_find_all(const StrSearcher *searcher, const Str *str, int64_t *indexes, int64_t max)
+{
+    return str_searcher_find_all_str(searcher, str->value, str->length, indexes, max);
+}
+
+/**
+ * Counts the non-overlapping occurrences of the needle in the given string.
+ *
+ * @param searcher A handle to the StrSearcher object.
+ * @param s A pointer to the string to search in.
+ * @param length The length of the string. Pass a negative value to calculate the length internally.
+ *
+ * @return The number of occurrences.
+ */
+static inline int64_t str_searcher_count_str(const StrSearcher *searcher, const char *s, int64_t length)
+{
+    return str_searcher_find_all_str(searcher, s, length, NULL, 0);
+}
+
+/**
+ * Counts the non-overlapping occurrences of the needle in the Str object.
+ *
+ * @param searcher A handle to the StrSearcher object.
+ * @param str A handle to the Str object to search in.
+ *
+ * @return The number of occurrences.
+ */
+static inline int64_t str_searcher_count(const StrSearcher *searcher, const Str *str)
+{
+    return str_searcher_find_all_str(searcher, str->value, str->length, NULL, 0);
+}
+
+/**
+ * Compiles a set of patterns into a StrMatcher object. The patterns are copied.
+ *
+ * @param matcher A handle to the StrMatcher object to initialize.
+ * @param patterns An array of pointers to the patterns. The index of each pattern is its pattern id.
+ * @param lengths An array with the length of each pattern. Pass NULL, or a negative value for a single pattern,
+ * to calculate the lengths internally.
+ * @param count The number of patterns.
+ *
+ * @return True if the StrMatcher object was initialized; otherwise false. Empty patterns are rejected.
+ */
+bool str_matcher_init(StrMatcher *matcher, const char *const *patterns, const int64_t *lengths, int count);
+
+/**
+ * Finalizes the StrMatcher handle and memory resources are deallocated.
+ * This function is NULL-safe. The function does nothing if NULL is passed as argument.
+ *
+ * @param matcher A handle to the StrMatcher object to finalize.
+ */
+void str_matcher_finalize(StrMatcher *matcher);
+
+/**
+ * Finds the first match of any pattern in the given string. The first match is the one that ends first;
+ * if several patterns end at the same position, the longest one (then the lowest pattern id) is reported.
+ *
+ * @param matcher A handle to the StrMatcher object.
+ * @param s A pointer to the string to search in.
+ * @param length The length of the string. Pass a negative value to calculate the length internally.
+ * @param match A pointer that receives the match. May be NULL.
+ *
+ * @return True if any pattern was found; otherwise false.
+ */
+bool str_matcher_find_str(const StrMatcher *matcher, const char *s, int64_t length, StrMatch *match);
+
+/**
+ * Finds the first match of any pattern in the Str object. See str_matcher_find_str().
+ *
+ * @param matcher A handle to the StrMatcher object.
+ * @param str A handle to the Str object to search in.
+ * @param match A pointer that receives the match. May be NULL.
+ *
+ * @return True if any pattern was found; otherwise false.
+ */
+static inline bool str_matcher_find(const StrMatcher *matcher, const Str *str, StrMatch *match)
+{
+    return str_matcher_find_str(matcher, str->value, str->length, match);
+}
+
+/**
+ * Finds every match of every pattern in the given string, overlapping matches included.
+ * Matches are reported in the order in which they end, with the same tie rules as str_matcher_find_str().
+ *
+ * @param matcher A handle to the StrMatcher object.
+ * @param s A pointer to the string to search in.
+ * @param length The length of the string. Pass a negative value to calculate the length internally.
+ * @param matches An array that receives the matches. May be NULL if max is 0.
+ * @param max The capacity of the matches array. Matches past this number are counted but not stored.
+ *
+ * @return The total number of matches.
+ */
+int64_t str_matcher_find_all_str(const StrMatcher *matcher, const char *s, int64_t length, StrMatch *matches, int64_t max);
+
+/**
+ * Finds every match of every pattern in the Str object. See str_matcher_find_all_str().
+ *
+ * @param matcher A handle to the StrMatcher object.
+ * @param str A handle to the Str object to search in.
+ * @param matches An array that receives the matches. May be NULL if max is 0.
+ * @param max The capacity of the matches array. Matches past this number are counted but not stored.
+ *
+ * @return The total number of matches.
+ */
+static inline int64_t str_matcher_find_all(const StrMatcher *matcher, const Str *str, StrMatch *matches, int64_t max)
+{
+    return str_matcher_find_all_str(matcher, str->value, str->length, matches, max);
+}
+
+/**
+ * Initializes an arena allocator.
+ *
+ * @param arena A handle to the StrArena object to initialize.
+ * @param chunk_size The size of the chunks requested to malloc(). Pass 0 to use STR_ARENA_DEFAULT_CHUNK_SIZE.
+ */
+void str_arena_init(StrArena *arena, int64_t chunk_size);
+
+/**
+ * Releases every allocation of the arena at once. The chunks are kept to be reused.
+ * Str objects allocated from the arena must not be used afterwards.
+ *
+ * @param arena A handle to the StrArena object.
+ */
+void str_arena_reset(StrArena *arena);
+
+/**
+ * Finalizes the arena and its chunks are deallocated.
+ * This function is NULL-safe. The function does nothing if NULL is passed as argument.
+ *
+ * @param arena A handle to the StrArena object to finalize.
+ */
+void str_arena_finalize(StrArena *arena);
+
+#ifdef STR_HAVE_POSIX
+/**
+ * An allocator that maps memory directly with mmap(). On Linux, growing and shrinking use mremap(), which moves
+ * pages instead of copying bytes, so it suits strings that grow to many megabytes; every allocation takes at least
+ * one page. Thread-safe. Pass &str_mmap_allocator to str_init_allocator().
+ */
+extern const StrAllocator str_mmap_allocator;
+#endif
+
+/**
+ * An allocator whose buffers carry an atomic reference count, which makes str_copy() share the buffer instead of
+ * copying it. The first modification of a sharing Str object copies the value into a private buffer, so copies
+ * can be handed to other threads. Memory comes from malloc(). Pass &str_shared_allocator to str_init_allocator().
+ */
+extern const StrAllocator str_shared_allocator;
+
+/**
+ * Initializes a size-class pool allocator.
+ *
+ * @param pool A handle to the StrPoolAllocator object to initialize.
+ */
+void str_pool_allocator_init(StrPoolAllocator *pool);
+
+/**
+ * Finalizes the pool allocator and its memory is deallocated.
+ * This function is NULL-safe. The function does nothing if NULL is passed as argument.
+ *
+ * @param pool A handle to the StrPoolAllocator object to finalize.
+ */
+void str_pool_allocator_finalize(StrPoolAllocator *pool);
+
+/**
+ * Returns a view of the whole value of the Str object.
+ * The view is invalidated by any operation that modifies or reallocates the Str object.
+ *
+ * @param str A handle to the Str object.
+ *
+ * @return A view of the Str object.
+ */
+static inline StrView str_view(const Str *str)
+{
+    StrView view = {str->value, str->length};
+    return view;
+}
+
+/**
+ * Returns a view of the given string.
+ *
+ * @param s A pointer to the string.
+ * @param length The length of the string. Pass a negative value to calculate the length internally.
+ *
+ * @return A view of the string.
+ */
+StrView str_view_str(const char *s, int64_t length);
+
+/**
+ * Returns a view of a part of another view. The range is clamped to the bounds of the view.
+ *
+ * @param view The view to slice.
+ * @param start The zero-based index of the first character of the slice.
+ * @param length The length of the slice. Pass a negative value to slice up to the end of the view.
+ *
+ * @return A view of the slice.
+ */
+StrView str_view_slice(StrView view, int64_t start, int64_t length);
+
+/**
+ * Returns a view of a part of the Str object. The range is clamped to the bounds of the string.
+ *
+ * @param str A handle to the Str object.
+ * @param start The zero-based index of the first character of the slice.
+ * @param length The length of the slice. Pass a negative value to slice up to the end of the string.
+ *
+ * @return A view of the slice.
+ */
+static inline StrView str_slice(const Str *str, int64_t start, int64_t length)
+{
+    return str_view_slice(str_view(str), start, length);
+}
+
+/**
+ * Compares two views.
+ *
+ * @param a The first view.
+ * @param b The second view.
+ *
+ * @return A negative value if the first view is less than the second view, 0 if both views are equal or
+ * a positive value if the first view is greater than the second view.
+ */
+int str_view_compare(StrView a, StrView b);
+
+/**
+ * Returns true if both views are equal.
+ *
+ * @param a The first view.
+ * @param b The second view.
+ *
+ * @return True if both views contain the same value; otherwise false.
+ */
+bool str_view_equals(StrView a, StrView b);
+
+/**
+ * Returns the zero-based index of the first occurrence of the needle.
+ *
+ * @param view The view to search in.
+ * @param needle The view to search.
+ *
+ * @return The zero-based index of the first occurrence or -1 if the needle is not present.
+ */
+int64_t str_view_indexof(StrView view, StrView needle);
+
+/**
+ * Returns true if the view starts with the given prefix.
+ *
+ * @param view The view.
+ * @param prefix The prefix.
+ *
+ * @return True if the view starts with the prefix.
+ */
+bool str_view_starts_with(StrView view, StrView prefix);
+
+/**
+ * Returns true if the view ends with the given suffix.
+ *
+ * @param view The view.
+ * @param suffix The suffix.
+ *
+ * @return True if the view ends with the suffix.
+ */
+bool str_view_ends_with(StrView view, StrView suffix);
+
+/**
+ * Returns the view without the whitespace at its beginning and its end. Nothing is moved or copied.
+ *
+ * @param view The view to trim.
+ * @param options Trim options.
+ *
+ * @return The trimmed view.
+ */
+StrView str_view_trim(StrView view, StrTrimOptions options);
+
+/**
+ * Returns the view without the bytes of the set at its beginning and its end. Nothing is moved or copied.
+ *
+ * @param view The view to trim.
+ * @param set A handle to the compiled set of bytes to strip.
+ * @param options Trim options.
+ *
+ * @return The trimmed view.
+ */
+StrView str_view_trim_charset(StrView view, const StrCharSet *set, StrTrimOptions options);
+
+/**
+ * Appends the value of a view.
+ *
+ * @param str A handle to the Str object.
+ * @param view The view to append.
+ *
+ * @return True if the view was appended successfully; otherwise false.
+ */
+static inline bool str_append_view(Str *str, StrView view)
+{
+    return str_append_str(str, view.value, view.length);
+}
+
+/**
+ * Appends the values of several views. The lengths are added up first so the buffer grows at most once.
+ *
+ * @param str A handle to the Str object.
+ * @param views The views to append.
+ * @param count The number of views.
+ *
+ * @return True if the views were appended successfully; otherwise false and the Str object is unchanged.
+ */
+bool str_append_many(Str *str, const StrView *views, int64_t count);
+
+/**
+ * Appends the values of several views with a separator between each pair. The buffer grows at most once.
+ *
+ * @param str A handle to the Str object.
+ * @param parts The views to join.
+ * @param count The number of views.
+ * @param separator The separator.
+ *
+ * @return True if the views were appended successfully; otherwise false and the Str object is unchanged.
+ */
+bool str_join(Str *str, const StrView *parts, int64_t count, StrView separator);
+
+/**
+ * Compiles a set of bytes.
+ *
+ * @param set A handle to the StrCharSet object to initialize.
+ * @param chars A pointer to the bytes of the set. Duplicates are ignored.
+ * @param length The number of bytes. Pass a negative value to calculate the length internally.
+ */
+void str_charset_init(StrCharSet *set, const char *chars, int64_t length);
+
+/**
+ * Returns true if the byte belongs to the set.
+ *
+ * @param set A handle to the StrCharSet object.
+ * @param c The byte to test.
+ *
+ * @return True if the byte belongs to the set; otherwise false.
+ */
+static inline bool str_charset_contains(const StrCharSet *set, char c)
+{
+    unsigned char b = (unsigned char) c;
+    return (set->bitmap[b >> 6] >> (b & 63)) & 1;
+}
+
+/**
+ * Initializes an iterator over the fields of a string.
+ *
+ * @param split A handle to the StrSplit object to initialize.
+ * @param source The string to split. It must outlive the iterator and the fields.
+ * @param delimiters A pointer to the delimiter bytes. Any of them ends a field.
+ * @param length The number of delimiter bytes. Pass a negative value to calculate the length internally.
+ * @param limit The maximum number of splits; the last field holds the rest of the string.
+ * Pass a negative value for no limit.
+ * @param options Split options. STR_SPLIT_SKIP_EMPTY skips the empty fields between consecutive delimiters.
+ */
+void str_split_init(StrSplit *split, StrView source, const char *delimiters, int64_t length, int64_t limit, StrSplitOptions options);
+
+/**
+ * Returns the next field.
+ *
+ * @param split A handle to the StrSplit object.
+ * @param field A pointer that receives the field.
+ *
+ * @return True if a field was returned; false if there are no more fields.
+ */
+bool str_split_next(StrSplit *split, StrView *field);
+
+/**
+ * Splits a string into an array of fields.
+ *
+ * @param source The string to split.
+ * @param delimiters A pointer to the delimiter bytes. Any of them ends a field.
+ * @param length The number of delimiter bytes. Pass a negative value to calculate the length internally.
+ * @param fields An array that receives the fields. If there are more fields than max, the last element
+ * holds the rest of the string.
+ * @param max The capacity of the fields array.
+ * @param options Split options. STR_SPLIT_SKIP_EMPTY skips the empty fields between consecutive delimiters.
+ *
+ * @return The number of fields stored in the array.
+ */
+int64_t str_split_into(StrView source, const char *delimiters, int64_t length, StrView *fields, int64_t max, StrSplitOptions options);
+
+/**
+ * Parses a signed 64-bit integer at the beginning of the given string: an optional sign followed by decimal digits.
+ * Whitespace is not skipped and the parsing stops at the first character that is not a digit.
+ *
+ * @param s A pointer to the string.
+ * @param length The length of the string. Pass a negative value to calculate the length internally.
+ * @param value A pointer that receives the value. On overflow it receives INT64_MIN or INT64_MAX.
+ * @param consumed A pointer that receives the number of characters parsed. May be NULL.
+ *
+ * @return STR_PARSE_OK, STR_PARSE_INVALID if there are no digits or STR_PARSE_OVERFLOW if the value is out of range.
+ */
+StrParseResult str_parse_int_str(const char *s, int64_t length, int64_t *value, int64_t *consumed);
+
+/**
+ * Parses a signed 64-bit integer at the beginning of the Str object. See str_parse_int_str().
+ *
+ * @param str A handle to the Str object.
+ * @param value A pointer that receives the value. On overflow it receives INT64_MIN or INT64_MAX.
+ * @param consumed A pointer that receives the number of characters parsed. May be NULL.
+ *
+ * @return STR_PARSE_OK, STR_PARSE_INVALID if there are no digits or STR_PARSE_OVERFLOW if the value is out of range.
+ */
+static inline StrParseResult str_parse_int(const Str *str, int64_t *value, int64_t *consumed)
+{
+    return str_parse_int_str(str->value, str->length, value, consumed);
+}
+
+/**
+ * Parses an unsigned 64-bit integer at the beginning of the given string: an optional '+' followed by decimal
+ * digits. Whitespace is not skipped and the parsing stops at the first character that is not a digit.
+ *
+ * @param s A pointer to the string.
+ * @param length The length of the string. Pass a negative value to calculate the length internally.
+ * @param value A pointer that receives the value. On overflow it receives UINT64_MAX.
+ * @param consumed A pointer that receives the number of characters parsed. May be NULL.
+ *
+ * @return STR_PARSE_OK, STR_PARSE_INVALID if there are no digits or STR_PARSE_OVERFLOW if the value is out of range.
+ */
+StrParseResult str_parse_uint_str(const char *s, int64_t length, uint64_t *value, int64_t *consumed);
+
+/**
+ * Parses an unsigned 64-bit integer at the beginning of the Str object. See str_parse_uint_str().
+ *
+ * @param str A handle to the Str object.
+ * @param value A pointer that receives the value. On overflow it receives UINT64_MAX.
+ * @param consumed A pointer that receives the number of characters parsed. May be NULL.
+ *
+ * @return STR_PARSE_OK, STR_PARSE_INVALID if there are no digits or STR_PARSE_OVERFLOW if the value is out of range.
+ */
+static inline StrParseResult str_parse_uint(const Str *str, uint64_t *value, int64_t *consumed)
+{
+    return str_parse_uint_str(str->value, str->length, value, consumed);
+}
+
+/**
+ * Parses a double at the beginning of the given string: an optional sign, digits with an optional '.' and an
+ * optional exponent, or "inf", "infinity" and "nan" in any case. The decimal separator is always '.', whatever
+ * the locale. The result is correctly rounded, so the output of str_append_float() and str_append_float_shortest()
+ * parses back to the same value.
+ *
+ * @param s A pointer to the string.
+ * @param length The length of the string. Pass a negative value to calculate the length internally.
+ * @param value A pointer that receives the value. On overflow it receives an infinity.
+ * @param consumed A pointer that receives the number of characters parsed. May be NULL.
+ *
+ * @return STR_PARSE_OK, STR_PARSE_INVALID if there is no number or STR_PARSE_OVERFLOW if the value is too large.
+ */
+StrParseResult str_parse_double_str(const char *s, int64_t length, double *value, int64_t *consumed);
+
+/**
+ * Parses a double at the beginning of the Str object. See str_parse_double_str().
+ *
+ * @param str A handle to the Str object.
+ * @param value A pointer that receives the value. On overflow it receives an infinity.
+ * @param consumed A pointer that receives the number of characters parsed. May be NULL.
+ *
+ * @return STR_PARSE_OK, STR_PARSE_INVALID if there is no number or STR_PARSE_OVERFLOW if the value is too large.
+ */
+static inline StrParseResult str_parse_double(const Str *str, double *value, int64_t *consumed)
+{
+    return str_parse_double_str(str->value, str->length, value, consumed);
+}
+
+/**
+ * Sets the seed used by str_hash(). Choosing a random seed at startup prevents attackers from crafting keys that
+ * collide. It must be set before any Str object is hashed, since cached hashes are not recomputed.
+ *
+ * @param seed The new seed. The default seed is 0.
+ */
+void str_set_hash_seed(uint64_t seed);
+
+/**
+ * Calculates a 64-bit hash of the given string with wyhash. The result is never 0.
+ *
+ * @param s A pointer to the string.
+ * @param length The length of the string. Pass a negative value to calculate the length internally.
+ * @param seed The seed of the hash.
+ *
+ * @return The hash of the string.
+ */
+uint64_t str_hash_str(const char *s, int64_t length, uint64_t seed);
+
+/**
+ * Returns the hash of the value of the Str object with the seed set by str_set_hash_seed(). The hash is cached in
+ * the object until the value changes, and lets str_equals() reject different values without comparing them.
+ *
+ * @param str A handle to the Str object.
+ *
+ * @return The hash of the value, which is never 0.
+ */
+uint64_t str_hash(Str *str);
+
+#ifdef STR_HAVE_POSIX
+/**
+ * Initializes a string interning pool. The pool hashes with the seed set by str_set_hash_seed() at this point.
+ *
+ * @param pool A handle to the StrPool object to initialize.
+ *
+ * @return True if the pool was initialized successfully; otherwise false.
+ */
+bool str_pool_init(StrPool *pool);
+
+/**
+ * Finalizes the pool. Every interned view is invalidated.
+ * This function is NULL-safe. The function does nothing if NULL is passed as argument.
+ *
+ * @param pool A handle to the StrPool object to finalize.
+ */
+void str_pool_finalize(StrPool *pool);
+
+/**
+ * Returns the canonical copy of the given string, adding it to the pool if it is not present yet.
+ * This function is thread-safe.
+ *
+ * @param pool A handle to the StrPool object.
+ * @param s A pointer to the string.
+ * @param length The length of the string. Pass a negative value to calculate the length internally.
+ * @param interned A pointer that receives the view of the canonical copy.
+ *
+ * @return True if the string was interned successfully; otherwise false.
+ */
+bool str_pool_intern_str(StrPool *pool, const char *s, int64_t length, StrView *interned);
+
+/**
+ * Returns the canonical copy of the value of the Str object, adding it to the pool if it is not present yet.
+ * The hash cached by str_hash() is reused when the pool has the same seed. This function is thread-safe as long
+ * as the Str object is not shared.
+ *
+ * @param pool A handle to the StrPool object.
+ * @param str A handle to the Str object.
+ * @param interned A pointer that receives the view of the canonical copy.
+ *
+ * @return True if the string was interned successfully; otherwise false.
+ */
+bool str_pool_intern(StrPool *pool, Str *str, StrView *interned);
+
+/**
+ * Finds the canonical copy of the given string without adding it. This function is thread-safe and lock-free.
+ *
+ * @param pool A handle to the StrPool object.
+ * @param s A pointer to the string.
+ * @param length The length of the string. Pass a negative value to calculate the length internally.
+ * @param interned A pointer that receives the view of the canonical copy.
+ *
+ * @return True if the string is in the pool; otherwise false.
+ */
+bool str_pool_lookup_str(const StrPool *pool, const char *s, int64_t length, StrView *interned);
+
+/**
+ * Reads a whole file into an uninitialized Str object. Regular files are read into a buffer allocated once with
+ * the size of the file; other files (pipes, /proc entries) are read until the end.
+ *
+ * @param str A handle to the uninitialized Str object. This object must not be initialized, otherwise it will
+ * result in a memory leak due to double initialization.
+ * @param path The path of the file.
+ *
+ * @return True if the file was read successfully; otherwise false, errno is set and the Str object is left
+ * finalized.
+ */
+bool str_from_file(Str *str, const char *path);
+
+/**
+ * Appends everything that can be read from the file descriptor until the end of the file. The capacity is
+ * reserved once from the size of the file when the descriptor refers to a regular file.
+ *
+ * @param str A handle to the Str object.
+ * @param fd An open file descriptor.
+ *
+ * @return True if the end of the file was reached; otherwise false, errno is set and the bytes read before the
+ * error are kept.
+ */
+bool str_append_fd(Str *str, int fd);
+
+/**
+ * Writes the whole value of the Str object to the file descriptor, retrying partial writes.
+ *
+ * @param str A handle to the Str object.
+ * @param fd An open file descriptor.
+ *
+ * @return True if every byte was written; otherwise false and errno is set.
+ */
+bool str_write_fd(const Str *str, int fd);
+
+/**
+ * Writes the value of the Str object to a file, replacing its content. The file is created if it does not exist.
+ *
+ * @param str A handle to the Str object.
+ * @param path The path of the file.
+ *
+ * @return True if the file was written successfully; otherwise false and errno is set.
+ */
+bool str_write_file(const Str *str, const char *path);
+
+/**
+ * Maps a whole file read-only into memory. Nothing is copied: pages are loaded on demand when the view is read.
+ *
+ * @param mapping A handle to the StrMapping object to initialize.
+ * @param path The path of the file.
+ *
+ * @return True if the file was mapped successfully; otherwise false and errno is set.
+ */
+bool str_mapping_init(StrMapping *mapping, const char *path);
+
+/**
+ * Unmaps the file. The view must not be used afterwards.
+ * This function is NULL-safe. The function does nothing if NULL is passed as argument.
+ *
+ * @param mapping A handle to the StrMapping object to finalize.
+ */
+void str_mapping_finalize(StrMapping *mapping);
+
+/**
+ * Initializes a line reader. The reader does not own the file descriptor.
+ *
+ * @param reader A handle to the StrReader object to initialize.
+ * @param fd An open file descriptor.
+ * @param buffer_size The initial size of the buffer. Pass 0 to use STR_READER_DEFAULT_BUFFER_SIZE. The buffer
+ * grows when a line does not fit.
+ * @param options STR_READER_STRIP_CR removes the '\r' of lines that end with "\r\n".
+ *
+ * @return True if the reader was initialized successfully; otherwise false.
+ */
+bool str_reader_init(StrReader *reader, int fd, int64_t buffer_size, StrReaderOptions options);
+
+/**
+ * Finalizes the reader and its buffer is deallocated. The file descriptor is not closed.
+ * This function is NULL-safe. The function does nothing if NULL is passed as argument.
+ *
+ * @param reader A handle to the StrReader object to finalize.
+ */
+void str_reader_finalize(StrReader *reader);
+
+/**
+ * Reads the next line. The line does not include its '\n'. The last line of the file is returned even if it does
+ * not end with '\n'.
+ *
+ * @param reader A handle to the StrReader object.
+ * @param line A pointer that receives a view of the line. The view is valid until the next call.
+ *
+ * @return True if a line was read; false at the end of the file or on error, in which case the error field of
+ * the reader holds the errno value.
+ */
+bool str_reader_next_line(StrReader *reader, StrView *line);
+
+/**
+ * Initializes a batched writer. The writer does not own the file descriptor.
+ *
+ * @param writer A handle to the StrWriter object to initialize.
+ * @param fd An open file descriptor.
+ * @param flush_size The number of pending bytes that triggers a flush, which is also the size of the staging
+ * buffer. Pass 0 to use STR_WRITER_DEFAULT_FLUSH_SIZE.
+ * @param max_segments The number of pending segments that triggers a flush. Pass 0 to use
+ * STR_WRITER_DEFAULT_MAX_SEGMENTS.
+ *
+ * @return True if the writer was initialized successfully; otherwise false.
+ */
+bool str_writer_init(StrWriter *writer, int fd, int64_t flush_size, int max_segments);
+
+/**
+ * Finalizes the writer and its buffers are deallocated. Pending bytes are discarded: call str_writer_flush()
+ * first. The file descriptor is not closed.
+ * This function is NULL-safe. The function does nothing if NULL is passed as argument.
+ *
+ * @param writer A handle to the StrWriter object to finalize.
+ */
+void str_writer_finalize(StrWriter *writer);
+
+/**
+ * Queues a copy of the given string. Strings larger than the staging buffer are written immediately.
+ *
+ * @param writer A handle to the StrWriter object.
+ * @param s A pointer to the string.
+ * @param length The length of the string. Pass a negative value to calculate the length internally.
+ *
+ * @return True on success; otherwise false and the error field of the writer holds the errno value.
+ */
+bool str_writer_write_str(StrWriter *writer, const char *s, int64_t length);
+
+/**
+ * Queues a copy of the value of the Str object. See str_writer_write_str().
+ *
+ * @param writer A handle to the StrWriter object.
+ * @param str A handle to the Str object.
+ *
+ * @return True on success; otherwise false and the error field of the writer holds the errno value.
+ */
+static inline bool str_writer_write(StrWriter *writer, const Str *str)
+{
+    return str_writer_write_str(writer, str->value, str->length);
+}
+
+/**
+ * Queues the given string without copying it. The string must not be modified or deallocated until the next
+ * flush. Small strings are copied anyway, since a segment of their own costs more than the copy.
+ *
+ * @param writer A handle to the StrWriter object.
+ * @param s A pointer to the string.
+ * @param length The length of the string. Pass a negative value to calculate the length internally.
+ *
+ * @return True on success; otherwise false and the error field of the writer holds the errno value.
+ */
+bool str_writer_write_ref_str(StrWriter *writer, const char *s, int64_t length);
+
+/**
+ * Queues the value of the Str object without copying it. See str_writer_write_ref_str().
+ *
+ * @param writer A handle to the StrWriter object.
+ * @param str A handle to the Str object. It must not be modified or finalized until the next flush.
+ *
+ * @return True on success; otherwise false and the error field of the writer holds the errno value.
+ */
+static inline bool str_writer_write_ref(StrWriter *writer, const Str *str)
+{
+    return str_writer_write_ref_str(writer, str->value, str->length);
+}
+
+/**
+ * Writes every pending byte, retrying partial writes. After an error the pending bytes are discarded and every
+ * following call fails with the same error.
+ *
+ * @param writer A handle to the StrWriter object.
+ *
+ * @return True if everything was written; otherwise false and the error field of the writer holds the errno value.
+ */
+bool str_writer_flush(StrWriter *writer);
+#endif
+
+/**
+ * Initializes an empty rope. Chunks are allocated on the first append.
+ *
+ * @param rope A handle to the StrRope object to initialize.
+ * @param chunk_size The size of the chunks requested to malloc(). Pass 0 to use STR_ROPE_DEFAULT_CHUNK_SIZE.
+ */
+void str_rope_init(StrRope *rope, int64_t chunk_size);
+
+/**
+ * Finalizes the rope and its chunks are deallocated.
+ * This function is NULL-safe. The function does nothing if NULL is passed as argument.
+ *
+ * @param rope A handle to the StrRope object to finalize.
+ */
+void str_rope_finalize(StrRope *rope);
+
+/**
+ * Appends a string to the rope, filling the last chunk before allocating new ones.
+ *
+ * @param rope A handle to the StrRope object.
+ * @param s The string to append.
+ * @param length The length of the string. If negative, the length will be calculated.
+ *
+ * @return True if the string was appended successfully; otherwise false and the bytes that did not fit in the
+ * allocated chunks are not appended.
+ */
+bool str_rope_append_str(StrRope *rope, const char *s, int64_t length);
+
+/**
+ * Appends the value of the Str object to the rope. See str_rope_append_str().
+ *
+ * @param rope A handle to the StrRope object.
+ * @param str A handle to the Str object.
+ *
+ * @return True if the value was appended successfully; otherwise false.
+ */
+static inline bool str_rope_append(StrRope *rope, const Str *str)
+{
+    return str_rope_append_str(rope, str->value, str->length);
+}
+
+/**
+ * Moves the chunks of another rope to the end of the rope in constant time. The other rope is left empty and
+ * still has to be finalized.
+ *
+ * @param rope A handle to the StrRope object.
+ * @param other A handle to the StrRope object whose chunks are moved.
+ */
+void str_rope_concat(StrRope *rope, StrRope *other);
+
+/**
+ * Appends the content of the rope to the Str object. The Str object grows at most once.
+ *
+ * @param rope A handle to the StrRope object.
+ * @param str A handle to the Str object.
+ *
+ * @return True if the content was appended successfully; otherwise false and the Str object is unchanged.
+ */
+bool str_rope_flatten(const StrRope *rope, Str *str);
+
+#ifdef STR_HAVE_POSIX
+/**
+ * Writes the content of the rope to a file descriptor with writev(), straight from the chunks and retrying
+ * partial writes.
+ *
+ * @param rope A handle to the StrRope object.
+ * @param fd An open file descriptor.
+ *
+ * @return True if everything was written; otherwise false and errno holds the error.
+ */
+bool str_rope_write_fd(const StrRope *rope, int fd);
+
+/**
+ * Queues the content of the rope to a batched writer. Chunks are referenced rather than copied, so the rope must
+ * not change until the writer is flushed. See str_writer_write_ref_str().
+ *
+ * @param writer A handle to the StrWriter object.
+ * @param rope A handle to the StrRope object.
+ *
+ * @return True if the content was queued successfully; otherwise false.
+ */
+bool str_writer_write_rope(StrWriter *writer, const StrRope *rope);
+#endif
+
+/**
+ * Takes a snapshot of the statistics counters, summed over the running threads and the threads that have exited.
+ * Counters only grow: subtract two snapshots to measure an interval.
+ *
+ * @param stats A pointer that receives the counters.
+ *
+ * @return True if the library was compiled with STR_STATS; otherwise false and every counter is 0.
+ */
+bool str_stats_snapshot(StrStats *stats);
+
+/**
+ * Appends a readable listing of the counters to the Str object, one "name: value" line per counter and one line
+ * per non-empty size bucket.
+ *
+ * @param stats A handle to the counters, as returned by str_stats_snapshot().
+ * @param str A handle to the Str object.
+ *
+ * @return True if the listing was appended successfully; otherwise false.
+ */
+bool str_stats_dump(const StrStats *stats, Str *str);
\ No newline at end of file
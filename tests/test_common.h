@@ -0,0 +1,38 @@
+#ifndef STR_TEST_COMMON_H
+#define STR_TEST_COMMON_H
+
+/*
+ * Shared pieces of the test programs: a check macro that reports the failing expression and a failure counter.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static int test_failures = 0;
+
+#define TEST_CHECK(expression)                                                          \
+    do {                                                                                \
+        if (!(expression)) {                                                            \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #expression); \
+            test_failures++;                                                            \
+        }                                                                               \
+    } while (0)
+
+/**
+ * Prints the summary of a test program.
+ *
+ * @param name The name of the test program.
+ *
+ * @return The exit status of the test program.
+ */
+static inline int test_report(const char *name)
+{
+    if (test_failures > 0) {
+        fprintf(stderr, "%s: %d check(s) failed\n", name, test_failures);
+        return EXIT_FAILURE;
+    }
+    printf("%s: ok\n", name);
+    return EXIT_SUCCESS;
+}
+
+#endif
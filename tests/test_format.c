@@ -0,0 +1,115 @@
+/*
+ * Tests of the number formatting functions.
+ */
+
+#include "../str.h"
+#include "test_common.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+static void check_shortest(double value, const char *expected)
+{
+    Str str;
+    str_init(&str);
+    TEST_CHECK(str_append_float_shortest(&str, value));
+
+    if (strcmp(str.value, expected) != 0) {
+        fprintf(stderr, "%.17g: formatted %s, expected %s\n", value, str.value, expected);
+        test_failures++;
+    }
+
+    str_finalize(&str);
+}
+
+static void test_shortest(void)
+{
+    check_shortest(0.1, "0.1");
+    check_shortest(-0.0, "-0");
+    check_shortest(1e21, "1e+21");
+    check_shortest(1e-7, "1e-7");
+    check_shortest(123456.789, "123456.789");
+    check_shortest(0x1p-1074, "5e-324");
+    check_shortest(DBL_MAX, "1.7976931348623157e+308");
+    check_shortest(0x1p-1022, "2.2250738585072014e-308");
+    check_shortest(HUGE_VAL, "inf");
+    check_shortest(-HUGE_VAL, "-inf");
+
+    /* Values for which Grisu2 produced one digit too many */
+    check_shortest(-1.2177806878780999e-27, "-1.2177806878781e-27");
+    check_shortest(383780415785420060.0, "383780415785420000");
+    check_shortest(8.1126407341426299e+130, "8.11264073414263e+130");
+
+    /* 1e23 is a tie that parses to the even double below it: only the inclusive boundary gives "1e+23" */
+    check_shortest(1e23, "1e+23");
+}
+
+/**
+ * Returns the number of significant digits of a formatted number.
+ */
+static int significant_digits(const char *s)
+{
+    const char *end = s + strcspn(s, "e");
+    int digits = 0;
+    int zeros = 0;
+
+    for (; s < end; s++) {
+        if (*s == '0') {
+            zeros += digits > 0;
+        } else if (*s >= '1' && *s <= '9') {
+            digits += zeros + 1;
+            zeros = 0;
+        }
+    }
+
+    return digits;
+}
+
+/**
+ * Compares the length of the output with the shortest precision of printf("%.*e") that round trips, and checks
+ * that the output parses back to the value, on pseudo-random doubles.
+ */
+static void test_shortest_against_printf(void)
+{
+    uint64_t state = 0x2545f4914f6cdd1dULL;
+
+    for (int i = 0; i < 100000; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+
+        double value;
+        uint64_t bits = state & 0x7fefffffffffffffULL;
+        memcpy(&value, &bits, sizeof(value));
+
+        int precision = 1;
+        for (char s[32];; precision++) {
+            snprintf(s, sizeof(s), "%.*e", precision - 1, value);
+            if (strtod(s, NULL) == value) {
+                break;
+            }
+        }
+
+        Str str;
+        double parsed;
+        str_init(&str);
+        TEST_CHECK(str_append_float_shortest(&str, value));
+        TEST_CHECK(str_parse_double(&str, &parsed, NULL) == STR_PARSE_OK && parsed == value);
+
+        if (significant_digits(str.value) > precision) {
+            fprintf(stderr, "%.17g: formatted %s, %d digits are enough\n", value, str.value, precision);
+            test_failures++;
+        }
+
+        str_finalize(&str);
+    }
+}
+
+int main(void)
+{
+    test_shortest();
+    test_shortest_against_printf();
+    return test_report("test_format");
+}
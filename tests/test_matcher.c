@@ -0,0 +1,70 @@
+/*
+ * Tests of StrMatcher.
+ */
+
+#include "../str.h"
+#include "test_common.h"
+
+#include <string.h>
+
+/**
+ * Every byte value as a pattern, plus one longer pattern, needs one byte class more than fits in a byte.
+ */
+static void test_full_alphabet(void)
+{
+    char bytes[256];
+    const char *patterns[257];
+    int64_t lengths[257];
+
+    for (int i = 0; i < 256; i++) {
+        bytes[i] = (char) i;
+        patterns[i] = &bytes[i];
+        lengths[i] = 1;
+    }
+    patterns[256] = "\xffq";
+    lengths[256] = 2;
+
+    StrMatcher matcher;
+    TEST_CHECK(str_matcher_init(&matcher, patterns, lengths, 257));
+
+    StrMatch match;
+    TEST_CHECK(str_matcher_find_str(&matcher, "\xff", 1, &match));
+    TEST_CHECK(match.index == 0 && match.length == 1 && match.pattern == 255);
+
+    TEST_CHECK(str_matcher_find_str(&matcher, "\x00", 1, &match));
+    TEST_CHECK(match.index == 0 && match.length == 1 && match.pattern == 0);
+
+    StrMatch matches[8];
+    TEST_CHECK(str_matcher_find_all_str(&matcher, "\xffq", 2, matches, 8) == 3);
+    TEST_CHECK(matches[0].index == 0 && matches[0].pattern == 255);
+    TEST_CHECK(matches[1].index == 0 && matches[1].length == 2 && matches[1].pattern == 256);
+    TEST_CHECK(matches[2].index == 1 && matches[2].pattern == 'q');
+
+    for (int i = 0; i < 256; i++) {
+        TEST_CHECK(str_matcher_find_str(&matcher, &bytes[i], 1, &match) && match.pattern == i);
+    }
+
+    str_matcher_finalize(&matcher);
+}
+
+static void test_overlapping_patterns(void)
+{
+    const char *patterns[] = {"he", "she", "his", "hers"};
+    StrMatcher matcher;
+    TEST_CHECK(str_matcher_init(&matcher, patterns, NULL, 4));
+
+    StrMatch match;
+    TEST_CHECK(str_matcher_find_str(&matcher, "ushers", -1, &match));
+    TEST_CHECK(match.index == 1 && match.length == 3 && match.pattern == 1);
+    TEST_CHECK(str_matcher_find_all_str(&matcher, "ushers", -1, NULL, 0) == 3);
+    TEST_CHECK(!str_matcher_find_str(&matcher, "xyz", -1, &match));
+
+    str_matcher_finalize(&matcher);
+}
+
+int main(void)
+{
+    test_full_alphabet();
+    test_overlapping_patterns();
+    return test_report("test_matcher");
+}
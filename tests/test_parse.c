@@ -0,0 +1,143 @@
+/*
+ * Tests of the integer and double parsers.
+ */
+
+#include "../str.h"
+#include "test_common.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Parses the whole string as a double and checks that the result has exactly the expected bits.
+ */
+static void check_double(const char *s, double expected, StrParseResult expected_result)
+{
+    double value;
+    int64_t consumed;
+    StrParseResult result = str_parse_double_str(s, -1, &value, &consumed);
+
+    if (result != expected_result || consumed != (int64_t) strlen(s) || memcmp(&value, &expected, sizeof(value)) != 0) {
+        fprintf(stderr, "%s: parsed %a (result %d), expected %a (result %d)\n", s, value, (int) result, expected,
+                (int) expected_result);
+        test_failures++;
+    }
+}
+
+static void test_halfway_to_even(void)
+{
+    /* 2^53 + 1 and 2^53 + 3 lie exactly halfway between two doubles */
+    check_double("9007199254740993", 9007199254740992.0, STR_PARSE_OK);
+    check_double("9007199254740995", 9007199254740996.0, STR_PARSE_OK);
+    check_double("9007199254740993.0000000000000000001", 9007199254740994.0, STR_PARSE_OK);
+    check_double("9007199254740992.9999999999999999999", 9007199254740992.0, STR_PARSE_OK);
+
+    /* 1 + 2^-53 is halfway between 1 and the next double */
+    check_double("1.00000000000000011102230246251565404236316680908203125", 1.0, STR_PARSE_OK);
+    check_double("1.00000000000000011102230246251565404236316680908203126", 1.0 + DBL_EPSILON, STR_PARSE_OK);
+
+    /* A nonzero digit past the decimal buffer still breaks the tie */
+    char s[1100] = "9007199254740993.";
+    memset(s + strlen(s), '0', 1000);
+    strcat(s, "1");
+    check_double(s, 9007199254740994.0, STR_PARSE_OK);
+}
+
+static void test_subnormals(void)
+{
+    check_double("4.9406564584124654e-324", 0x1p-1074, STR_PARSE_OK);
+    check_double("2.4703282292062327e-324", 0.0, STR_PARSE_OK);
+    check_double("2.4703282292062328e-324", 0x1p-1074, STR_PARSE_OK);
+    check_double("2.2250738585072011e-308", 0x0.fffffffffffffp-1022, STR_PARSE_OK);
+    check_double("2.2250738585072012e-308", 0x1p-1022, STR_PARSE_OK);
+    check_double("2.22507385850720113605740979670913197593481954635164564e-308", 0x0.fffffffffffffp-1022,
+                 STR_PARSE_OK);
+    check_double("1e-400", 0.0, STR_PARSE_OK);
+    check_double("-1e-400", -0.0, STR_PARSE_OK);
+}
+
+static const char halfway_above_max[] =
+        "1797693134862315807937289714053034150799341327100378269361737789804449682927647509466490179775872070"
+        "9633028641669288791094655554785194040263065748867150582068190890200070838367627385484581771153176447"
+        "5730270069855571366959622842914819860834936475292719074168444365510704342711559699508093042880177904"
+        "174497792";
+
+static const char below_halfway_above_max[] =
+        "1797693134862315807937289714053034150799341327100378269361737789804449682927647509466490179775872070"
+        "9633028641669288791094655554785194040263065748867150582068190890200070838367627385484581771153176447"
+        "5730270069855571366959622842914819860834936475292719074168444365510704342711559699508093042880177904"
+        "174497791";
+
+static void test_overflow(void)
+{
+    check_double("1.7976931348623157e308", DBL_MAX, STR_PARSE_OK);
+    check_double("1.7976931348623158e308", DBL_MAX, STR_PARSE_OK);
+    /* 2^1024 - 2^970 is halfway between DBL_MAX, whose significand is odd, and 2^1024 */
+    check_double(halfway_above_max, HUGE_VAL, STR_PARSE_OVERFLOW);
+    check_double(below_halfway_above_max, DBL_MAX, STR_PARSE_OK);
+    check_double("1e309", HUGE_VAL, STR_PARSE_OVERFLOW);
+    check_double("-1e309", -HUGE_VAL, STR_PARSE_OVERFLOW);
+    check_double("1e99999999999999999999", HUGE_VAL, STR_PARSE_OVERFLOW);
+}
+
+static void test_long_significands(void)
+{
+    check_double("123456789012345678901234567890", 1.2345678901234568e29, STR_PARSE_OK);
+    check_double("0.1000000000000000055511151231257827021181583404541015625", 0.1, STR_PARSE_OK);
+    check_double("18446744073709551615", 18446744073709551616.0, STR_PARSE_OK);
+    check_double("18446744073709551616", 18446744073709551616.0, STR_PARSE_OK);
+    check_double("0.00000000000000000000000000000000000000000000000000000000000000000000000000000000000000000001",
+                 1e-92, STR_PARSE_OK);
+}
+
+/**
+ * Compares the parser with strtod() on pseudo-random values printed with 17 and 25 significant digits.
+ */
+static void test_against_strtod(void)
+{
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+
+    for (int i = 0; i < 200000; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+
+        double random;
+        uint64_t bits = state & 0x7fefffffffffffffULL;
+        memcpy(&random, &bits, sizeof(random));
+
+        char s[64];
+        snprintf(s, sizeof(s), (i & 1) ? "%.17g" : "%.24e", random);
+        check_double(s, strtod(s, NULL), STR_PARSE_OK);
+    }
+}
+
+static void test_integers(void)
+{
+    int64_t value;
+    uint64_t unsigned_value;
+    int64_t consumed;
+
+    TEST_CHECK(str_parse_int_str("-9223372036854775808", -1, &value, &consumed) == STR_PARSE_OK);
+    TEST_CHECK(value == INT64_MIN && consumed == 20);
+    TEST_CHECK(str_parse_int_str("9223372036854775808", -1, &value, NULL) == STR_PARSE_OVERFLOW);
+    TEST_CHECK(value == INT64_MAX);
+    TEST_CHECK(str_parse_uint_str("18446744073709551615", -1, &unsigned_value, NULL) == STR_PARSE_OK);
+    TEST_CHECK(unsigned_value == UINT64_MAX);
+    TEST_CHECK(str_parse_uint_str("18446744073709551616", -1, &unsigned_value, NULL) == STR_PARSE_OVERFLOW);
+    TEST_CHECK(str_parse_int_str("12x", 2, &value, &consumed) == STR_PARSE_OK && value == 12 && consumed == 2);
+    TEST_CHECK(str_parse_int_str("x", -1, &value, &consumed) == STR_PARSE_INVALID && consumed == 0);
+}
+
+int main(void)
+{
+    test_halfway_to_even();
+    test_subnormals();
+    test_overflow();
+    test_long_significands();
+    test_against_strtod();
+    test_integers();
+    return test_report("test_parse");
+}